@@ -0,0 +1,592 @@
+// SirdsBench.cpp
+// Times SIRDSDrawer::ZBuffersToDrawer on synthetic depth scenes, headless
+
+#include "DrawSirds.h"
+#include "DrawSirdsTo.h"
+#include "SirdsFramePool.h"
+#include "SirdsPipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace SIRDS;
+
+namespace {
+
+	struct Size {
+		const char* name;
+		int width;
+		int height;
+	};
+
+	const Size kSizes[] = {
+		{ "720p", 1280, 720 },
+		{ "1080p", 1920, 1080 },
+		{ "4k", 3840, 2160 },
+	};
+
+	// Depth scenes as a function of normalised position (u, v) and a phase t
+	// that advances every frame. Values are raw depth: 0 is the near plane,
+	// 1 the far plane the game clears to.
+	using SceneFn = float (*)(float u, float v, float t, int x, int y);
+
+	float Hash(uint32_t x, uint32_t y, uint32_t seed)
+	{
+		uint32_t h = x * 0x8DA6B343u ^ y * 0xD8163841u ^ seed * 0xCB1AB31Fu;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return (h & 0xFFFF) / 65535.f;
+	}
+
+	float Plane(float u, float v, float t, int, int)
+	{
+		return 0.55f + 0.35f * ((u - 0.5f) * cosf(t) + (v - 0.5f) * sinf(t));
+	}
+
+	// Pipes like the game's: flat background with a few near columns.
+	float Columns(float u, float v, float t, int, int)
+	{
+		const float cell = u * 6.f + t * 0.25f;
+		const int column = static_cast<int>(floorf(cell));
+		if (cell - column > 0.3f)
+			return 1.f;
+		const float gap = 0.5f + 0.3f * sinf(column * 1.7f);
+		if (fabsf(v - gap) < 0.15f)
+			return 1.f;
+		return 0.45f + 0.1f * sinf(column + t);
+	}
+
+	float Sphere(float u, float v, float t, int, int)
+	{
+		const float cx = 0.5f + 0.25f * cosf(t);
+		const float cy = 0.5f + 0.15f * sinf(t);
+		const float dx = (u - cx) * 1.78f;
+		const float dy = v - cy;
+		const float r2 = (dx * dx + dy * dy) / (0.35f * 0.35f);
+		if (r2 >= 1.f)
+			return 1.f;
+		return 0.8f - 0.5f * sqrtf(1.f - r2);
+	}
+
+	// Bumpy surface: every 8x8 block at its own depth, new every frame.
+	float Noise(float, float, float t, int x, int y)
+	{
+		return 0.4f + 0.5f * Hash(x >> 3, y >> 3, static_cast<uint32_t>(t * 10.f));
+	}
+
+	// Terraces running across the screen, scrolling down.
+	float Steps(float, float v, float t, int, int)
+	{
+		const float s = v * 8.f + t;
+		return 0.3f + 0.7f * (static_cast<int>(s) % 8) / 8.f;
+	}
+
+	struct Scene {
+		const char* name;
+		SceneFn fn;
+	};
+
+	const Scene kScenes[] = {
+		{ "plane", Plane },
+		{ "columns", Columns },
+		{ "sphere", Sphere },
+		{ "noise", Noise },
+		{ "steps", Steps },
+	};
+
+	// Variants of the registered patterns, at the settings the game uses.
+	struct Pattern {
+		const char* name;
+		BackgroundConfig config;
+	};
+
+	vector<Pattern> BenchPatterns()
+	{
+		auto make = [](const char* name, const char* pattern, int pixelSize, int density2, int wolfram) {
+			Pattern p{ name, BackgroundConfig() };
+			p.config.method_ = FindPattern(pattern)->method;
+			p.config.pixelSize_ = pixelSize;
+			p.config.density2_ = density2;
+			p.config.wolframNumber_ = wolfram;
+			return p;
+		};
+		return {
+			make("dots-ps1", "dots", 1, 128, 1236),
+			make("dots-ps2", "dots", 2, 164, 1236),
+			make("dots-plain", "dots", 1, 0, 1236),
+			make("algo2", "dots2", 1, 164, 1236),
+			make("wolfram", "wolfram", 2, 164, 90),
+			make("wolfram3", "wolfram3", 2, 164, 1236),
+			make("voronoi", "voronoi", 2, 164, 1236),
+		};
+	}
+
+	struct Options {
+		vector<string> sizes{ "720p", "1080p", "4k" };
+		vector<string> scenes{ "plane", "columns", "sphere", "noise", "steps" };
+		vector<string> patterns;  // empty for all
+		vector<string> depths{ "float", "u16" };
+		vector<int> threads;
+		int frames = 20;
+		int warmup = 3;
+		bool still = false;
+		bool csv = false;
+		float pmm = 96.f / 25.4f;
+		LinkSolver solver = LinkSolver::Walk;
+		bool verifyLinks = false;
+		int pipelined = 0;  // FramePipeline capacity, 0 to draw on this thread
+	};
+
+	vector<string> Split(const string& s)
+	{
+		vector<string> out;
+		size_t begin = 0;
+		while (begin <= s.size()) {
+			size_t end = s.find(',', begin);
+			if (end == string::npos)
+				end = s.size();
+			if (end > begin)
+				out.push_back(s.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		return out;
+	}
+
+	template <class T>
+	bool Contains(const vector<T>& v, const T& x)
+	{
+		return find(v.begin(), v.end(), x) != v.end();
+	}
+
+	vector<int> DefaultThreads()
+	{
+		const int hw = max(1, static_cast<int>(thread::hardware_concurrency()));
+		vector<int> out;
+		for (int n = 1; n < hw; n *= 2)
+			out.push_back(n);
+		out.push_back(hw);
+		return out;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr,
+			"usage: sirds_bench [options]\n"
+			"  --sizes=720p,1080p,4k\n"
+			"  --scenes=plane,columns,sphere,noise,steps\n"
+			"  --patterns=NAME,...     default all:");
+		for (const Pattern& p : BenchPatterns())
+			fprintf(stderr, " %s", p.name);
+		fprintf(stderr, "\n"
+			"  --depth=float,u16\n"
+			"  --threads=1,2,4         default powers of two up to the core count\n"
+			"  --frames=N --warmup=N   timed and untimed frames per run (20, 3)\n"
+			"  --pmm=F                 pixels per mm (96 dpi)\n"
+			"  --static                keep the depth still, timing row reuse\n"
+			"  --solver=walk|unionfind how linked pixels are joined (walk)\n"
+			"  --verify-links          also run both solvers on every row; exits 1 if they differ\n"
+			"  --pipelined[=N]         produce depth while a FramePipeline converts, N frames queued (1)\n"
+			"  --quick                 720p, 5 frames, 1 and all threads\n"
+			"  --csv                   CSV instead of JSON\n");
+	}
+
+	bool Parse(int argc, char** argv, Options& o)
+	{
+		for (int i = 1; i < argc; i++) {
+			const string arg = argv[i];
+			const size_t eq = arg.find('=');
+			const string key = arg.substr(0, eq);
+			const string value = eq == string::npos ? string() : arg.substr(eq + 1);
+			if (key == "--sizes")
+				o.sizes = Split(value);
+			else if (key == "--scenes")
+				o.scenes = Split(value);
+			else if (key == "--patterns")
+				o.patterns = Split(value);
+			else if (key == "--depth")
+				o.depths = Split(value);
+			else if (key == "--threads") {
+				o.threads.clear();
+				for (const string& t : Split(value))
+					o.threads.push_back(max(1, atoi(t.c_str())));
+			}
+			else if (key == "--frames")
+				o.frames = max(1, atoi(value.c_str()));
+			else if (key == "--warmup")
+				o.warmup = max(0, atoi(value.c_str()));
+			else if (key == "--pmm")
+				o.pmm = static_cast<float>(atof(value.c_str()));
+			else if (key == "--static")
+				o.still = true;
+			else if (key == "--solver" && (value == "walk" || value == "unionfind"))
+				o.solver = value == "walk" ? LinkSolver::Walk : LinkSolver::UnionFind;
+			else if (key == "--verify-links")
+				o.verifyLinks = true;
+			else if (key == "--pipelined")
+				o.pipelined = value.empty() ? 1 : max(1, atoi(value.c_str()));
+			else if (key == "--csv")
+				o.csv = true;
+			else if (key == "--quick") {
+				o.sizes = { "720p" };
+				o.frames = 5;
+				o.warmup = 1;
+				o.threads = { 1 };
+				if (thread::hardware_concurrency() > 1)
+					o.threads.push_back(static_cast<int>(thread::hardware_concurrency()));
+			}
+			else {
+				Usage();
+				return false;
+			}
+		}
+		if (o.threads.empty())
+			o.threads = DefaultThreads();
+		return true;
+	}
+
+	// One eye's depth for frame t. The right eye sees the scene shifted by a
+	// little parallax, as the game's second render does.
+	struct DepthPair {
+		vector<float> left, right;
+		vector<uint16_t> left16, right16;
+
+		void Fill(const Scene& scene, int width, int height, float t, bool depth16)
+		{
+			left.resize(static_cast<size_t>(width) * height);
+			right.resize(left.size());
+			const int parallax = max(1, width / 200);
+			for (int y = 0; y < height; y++) {
+				const float v = (y + 0.5f) / height;
+				float* l = &left[static_cast<size_t>(y) * width];
+				float* r = &right[static_cast<size_t>(y) * width];
+				for (int x = 0; x < width; x++)
+					l[x] = min(1.f, max(0.f, scene.fn((x + 0.5f) / width, v, t, x, y)));
+				for (int x = 0; x < width; x++)
+					r[x] = l[min(width - 1, x + parallax)];
+			}
+			if (!depth16)
+				return;
+			left16.resize(left.size());
+			right16.resize(right.size());
+			auto unorm = [](float d) { return static_cast<uint16_t>(lrintf(d * 65535.f)); };
+			transform(left.begin(), left.end(), left16.begin(), unorm);
+			transform(right.begin(), right.end(), right16.begin(), unorm);
+		}
+	};
+
+	// Stands in for the game's deferred TextureSink: the converter draws into
+	// one pooled buffer, and Upload() on the producer's thread copies the
+	// finished frame out as the texture upload would. The next frame is not
+	// started until the last one went up.
+	class MemorySink : public FrameSink
+	{
+	public:
+		explicit MemorySink(DXGI_FORMAT format) : format_(format) {}
+
+		PixelView BeginFrame(int width, int height) override
+		{
+			{
+				unique_lock<mutex> lock(mutex_);
+				uploaded_.wait(lock, [this] { return !ready_; });
+			}
+			if (width != frame_.Width() || height != frame_.Height()) {
+				frame_.Reset();
+				frame_ = FramePool::Shared().Acquire(width, height, format_);
+				shown_.assign(static_cast<size_t>(width) * height, 0);
+			}
+			return frame_.Pixels();
+		}
+
+		void EndFrame() override
+		{
+			lock_guard<mutex> lock(mutex_);
+			ready_ = true;
+		}
+
+		// Copies out a finished frame, if there is one, and stamps the time.
+		bool Upload()
+		{
+			{
+				lock_guard<mutex> lock(mutex_);
+				if (!ready_)
+					return false;
+			}
+			const PixelView pixels = frame_.Pixels();
+			for (int y = 0; y < pixels.height; y++)
+				memcpy(&shown_[static_cast<size_t>(y) * pixels.width], pixels.Row(y), pixels.width * sizeof(uint32_t));
+			uploads_.push_back(chrono::steady_clock::now());
+			{
+				lock_guard<mutex> lock(mutex_);
+				ready_ = false;
+			}
+			uploaded_.notify_all();
+			return true;
+		}
+
+		// The last uploaded frame, and when each frame went up.
+		PixelView Shown() { return PixelView(shown_.data(), frame_.Width(), frame_.Height()); }
+		const vector<chrono::steady_clock::time_point>& Uploads() const { return uploads_; }
+
+	private:
+		DXGI_FORMAT format_;
+		FrameLease frame_;
+		vector<uint32_t> shown_;
+		vector<chrono::steady_clock::time_point> uploads_;
+		bool ready_ = false;
+		mutex mutex_;
+		condition_variable uploaded_;
+	};
+
+	// FNV-1a over the pixels, to compare a pipelined run's last frame with
+	// the same frame drawn synchronously.
+	uint64_t FrameHash(const PixelView& pixels)
+	{
+		uint64_t h = 0xCBF29CE484222325ull;
+		for (int y = 0; y < pixels.height; y++) {
+			const uint32_t* row = pixels.Row(y);
+			for (int x = 0; x < pixels.width; x++) {
+				h ^= row[x];
+				h *= 0x100000001B3ull;
+			}
+		}
+		return h;
+	}
+
+	struct Result {
+		string scene, size, pattern, depth;
+		int width = 0, height = 0, threads = 0, frames = 0;
+		double rowsPerSec = 0, nsPerPixel = 0, meanMs = 0, p50Ms = 0, p99Ms = 0;
+		double fps = 0, latencyP50Ms = 0, latencyP99Ms = 0;
+		uint64_t hash = 0;
+	};
+
+	// Nearest-rank percentile of sorted samples.
+	double Percentile(const vector<double>& sorted, double p)
+	{
+		const size_t rank = static_cast<size_t>(ceil(p / 100.0 * sorted.size()));
+		return sorted[min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	double Ms(chrono::steady_clock::duration d)
+	{
+		return chrono::duration<double, milli>(d).count();
+	}
+
+	// ms are the frame times, latency the time from starting a frame's depth
+	// to its finished picture, and wall the time the timed frames took.
+	Result Summarise(const Scene& scene, const Size& size, bool depth16, int threads, vector<double> ms,
+		vector<double> latency, double wallMs)
+	{
+		Result r;
+		r.scene = scene.name;
+		r.size = size.name;
+		r.depth = depth16 ? "u16" : "float";
+		r.width = size.width;
+		r.height = size.height;
+		r.threads = threads;
+		r.frames = static_cast<int>(latency.size());
+		double total = 0;
+		for (double m : ms)
+			total += m;
+		r.meanMs = total / ms.size();
+		r.rowsPerSec = size.height / (r.meanMs / 1000.0);
+		r.nsPerPixel = r.meanMs * 1e6 / (static_cast<double>(size.width) * size.height);
+		sort(ms.begin(), ms.end());
+		r.p50Ms = Percentile(ms, 50);
+		r.p99Ms = Percentile(ms, 99);
+		r.fps = latency.size() / (wallMs / 1000.0);
+		sort(latency.begin(), latency.end());
+		r.latencyP50Ms = Percentile(latency, 50);
+		r.latencyP99Ms = Percentile(latency, 99);
+		return r;
+	}
+
+	// Produces each frame's depth and then converts it, on this thread.
+	Result Run(SIRDSDrawer& engine, DrawSIRDSToBitmap& drawer, const Scene& scene, const Size& size,
+		bool depth16, int threads, const Options& o, DepthPair& depth)
+	{
+		engine.iWorkers_ = threads;
+		vector<double> ms, latency;
+		double wallMs = 0;
+		for (int f = 0; f < o.warmup + o.frames; f++) {
+			const float t = o.still ? 0.f : f * 0.1f;
+			const auto produce = chrono::steady_clock::now();
+			if (f == 0 || !o.still)
+				depth.Fill(scene, size.width, size.height, t, depth16);
+
+			const auto start = chrono::steady_clock::now();
+			if (depth16)
+				engine.ZBuffersToDrawer(ViewOf(depth.left16, size.width, size.height),
+					ViewOf(depth.right16, size.width, size.height), &drawer);
+			else
+				engine.ZBuffersToDrawer(ViewOf(depth.left, size.width, size.height),
+					ViewOf(depth.right, size.width, size.height), &drawer);
+			const auto end = chrono::steady_clock::now();
+			if (f >= o.warmup) {
+				ms.push_back(Ms(end - start));
+				latency.push_back(Ms(end - produce));
+				wallMs += latency.back();
+			}
+		}
+
+		Result r = Summarise(scene, size, depth16, threads, move(ms), move(latency), wallMs);
+		r.hash = FrameHash(drawer.Target());
+		return r;
+	}
+
+	// Produces depth on this thread while a FramePipeline converts the frames
+	// before it into a MemorySink, the way the game's pipelined loop does.
+	// Frame times are the gaps between uploads.
+	Result RunPipelined(SIRDSDrawer& engine, DrawSIRDSToBitmap& drawer, const Scene& scene, const Size& size,
+		bool depth16, int threads, const Options& o)
+	{
+		engine.iWorkers_ = threads;
+		MemorySink sink(drawer.Format());
+		// Up to capacity frames are queued and one more is being converted,
+		// so the slot filled next is never one still in flight.
+		vector<shared_ptr<DepthPair>> slots(o.pipelined + 2);
+		for (auto& slot : slots)
+			slot = make_shared<DepthPair>();
+
+		const int total = o.warmup + o.frames;
+		vector<chrono::steady_clock::time_point> produced(total);
+		{
+			FramePipeline pipeline(engine, o.pipelined);
+			for (int f = 0; f < total; f++) {
+				const float t = o.still ? 0.f : f * 0.1f;
+				produced[f] = chrono::steady_clock::now();
+				const shared_ptr<DepthPair>& depth = slots[f % slots.size()];
+				if (f < static_cast<int>(slots.size()) || !o.still)
+					depth->Fill(scene, size.width, size.height, t, depth16);
+
+				DepthFrame frame;
+				if (depth16) {
+					frame.left16 = ViewOf(depth->left16, size.width, size.height);
+					frame.right16 = ViewOf(depth->right16, size.width, size.height);
+				}
+				else {
+					frame.left = ViewOf(depth->left, size.width, size.height);
+					frame.right = ViewOf(depth->right, size.width, size.height);
+				}
+				frame.keepAlive = depth;
+				frame.drawer = &drawer;
+				frame.sink = &sink;
+				pipeline.Submit(move(frame));
+				sink.Upload();
+			}
+			pipeline.Flush([&sink] { sink.Upload(); });
+			sink.Upload();
+		}
+
+		const auto& uploads = sink.Uploads();
+		vector<double> ms, latency;
+		for (int f = o.warmup; f < total; f++) {
+			if (f > o.warmup)
+				ms.push_back(Ms(uploads[f] - uploads[f - 1]));
+			latency.push_back(Ms(uploads[f] - produced[f]));
+		}
+		// One timed frame has no gap to measure; its latency stands in.
+		if (ms.empty())
+			ms.push_back(latency.front());
+		Result r = Summarise(scene, size, depth16, threads, move(ms), move(latency),
+			Ms(uploads.back() - produced[o.warmup]));
+		r.hash = FrameHash(sink.Shown());
+		return r;
+	}
+
+	void Print(const Result& r, bool csv, bool first)
+	{
+		if (csv) {
+			if (first)
+				printf("scene,size,width,height,pattern,depth,threads,frames,rows_per_sec,ns_per_pixel,mean_ms,p50_ms,p99_ms,"
+					"fps,latency_p50_ms,latency_p99_ms,hash\n");
+			printf("%s,%s,%d,%d,%s,%s,%d,%d,%.0f,%.3f,%.3f,%.3f,%.3f,%.1f,%.3f,%.3f,%016llx\n", r.scene.c_str(), r.size.c_str(),
+				r.width, r.height, r.pattern.c_str(), r.depth.c_str(), r.threads, r.frames,
+				r.rowsPerSec, r.nsPerPixel, r.meanMs, r.p50Ms, r.p99Ms,
+				r.fps, r.latencyP50Ms, r.latencyP99Ms, static_cast<unsigned long long>(r.hash));
+		}
+		else {
+			printf("%s    {\"scene\": \"%s\", \"size\": \"%s\", \"width\": %d, \"height\": %d, \"drawer\": \"DrawSIRDSToBitmap\", "
+				"\"pattern\": \"%s\", \"depth\": \"%s\", \"threads\": %d, \"frames\": %d, \"rows_per_sec\": %.0f, "
+				"\"ns_per_pixel\": %.3f, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, \"fps\": %.1f, "
+				"\"latency_p50_ms\": %.3f, \"latency_p99_ms\": %.3f, \"hash\": \"%016llx\"}",
+				first ? "" : ",\n", r.scene.c_str(), r.size.c_str(), r.width, r.height, r.pattern.c_str(),
+				r.depth.c_str(), r.threads, r.frames, r.rowsPerSec, r.nsPerPixel, r.meanMs, r.p50Ms, r.p99Ms,
+				r.fps, r.latencyP50Ms, r.latencyP99Ms, static_cast<unsigned long long>(r.hash));
+		}
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options o;
+	if (!Parse(argc, argv, o))
+		return 2;
+
+	// The engine is a singleton: drawers read its depth mapping through
+	// SIRDSDrawer::GetDrawer(), so one instance serves every run.
+	SIRDSDrawer engine;
+	engine.fPMM_ = o.pmm;
+	engine.bStableDots_ = true;
+	engine.linkSolver_ = o.solver;
+	engine.bVerifyLinks_ = o.verifyLinks;
+
+	if (!o.csv)
+		printf("{\n  \"hardware_threads\": %u,\n  \"static\": %s,\n  \"solver\": \"%s\",\n  \"pipelined\": %d,\n"
+			"  \"results\": [\n", thread::hardware_concurrency(), o.still ? "true" : "false",
+			o.solver == LinkSolver::Walk ? "walk" : "unionfind", o.pipelined);
+
+	bool first = true;
+	DepthPair depth;
+	for (const Size& size : kSizes) {
+		if (!Contains(o.sizes, string(size.name)))
+			continue;
+		for (const Pattern& pattern : BenchPatterns()) {
+			if (!o.patterns.empty() && !Contains(o.patterns, string(pattern.name)))
+				continue;
+			BackgroundConfig config = pattern.config;
+			DrawSIRDSToBitmap drawer;
+			drawer.Init(config);
+			drawer.InitBackground(size.width, size.height);
+			drawer.InitPicture(size.width, size.height, [](int) {});
+			for (const Scene& scene : kScenes) {
+				if (!Contains(o.scenes, string(scene.name)))
+					continue;
+				for (const string& d : o.depths) {
+					for (int threads : o.threads) {
+						Result r = o.pipelined > 0 ?
+							RunPipelined(engine, drawer, scene, size, d == "u16", threads, o) :
+							Run(engine, drawer, scene, size, d == "u16", threads, o, depth);
+						r.pattern = pattern.name;
+						Print(r, o.csv, first);
+						first = false;
+					}
+				}
+			}
+		}
+	}
+
+	if (!o.csv)
+		printf("\n  ]\n}\n");
+	fflush(stdout);
+	if (o.verifyLinks) {
+		fprintf(stderr, "link solvers disagree on %llu rows\n",
+			static_cast<unsigned long long>(engine.linkMismatches_.load()));
+		if (engine.linkMismatches_.load() != 0)
+			return 1;
+	}
+	return 0;
+}
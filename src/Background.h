@@ -1,27 +1,10 @@
 #pragma once
 #include "DirectXTex.h"
 #include <string>
+#include "SirdsBackgroundConfig.h"
 
 namespace SIRDS {
 
-	// Encapsulates configurable background parameters that used to live directly
-	// on the Background class.
-	class BackgroundConfig {
-	public:
-		BackgroundConfig() = default;
-
-		int density_ = 64;
-		int density2_ = 164;
-		int wolframNumber_ = 1236;
-		int method_ = 1;
-		int pixelSize_ = 2;
-		unsigned int color1_ = 0xFF010101;
-		unsigned int color2_ = 0xFF00FF00;
-		unsigned int color3_ = 0xFF7700FF;
-		int hidden_ = 1;
-		std::wstring bitmapPath_;
-	};
-
 	class Background {
 	public:
 		Background() :
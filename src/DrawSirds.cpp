@@ -1,16 +1,10 @@
-#include <DirectXMath.h>
-#include <DirectXColors.h>
-#include <random>
 #include "DrawSirds.h"
 #include <algorithm>
-#include "DrawSirdsTo.h"
-#include <fstream>
-#include "ppl.h"
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
 
 using namespace std;
-using namespace concurrency;
-using namespace DirectX;
-using namespace Concurrency;
 
 namespace SIRDS
 {
@@ -20,6 +14,22 @@ namespace SIRDS
 			m_Progress(progress);
 	}
 
+	void DrawSirdsInterface::Invalidate()
+	{
+		static std::atomic<uint32_t> versions{ 0 };
+		m_Version = ++versions;
+	}
+
+	void DrawSirdsInterface::SetTarget(PixelView target)
+	{
+		if (target.data == m_Target.data && target.rowPitch == m_Target.rowPitch &&
+			target.width == m_Target.width && target.height == m_Target.height)
+			return;
+		// Rows kept from the last frame live in the old target.
+		m_Target = target;
+		Invalidate();
+	}
+
 	SIRDSDrawer* SIRDSDrawer::singleSIRDSDrawer;
 
 	void SIRDSDrawer::InitStatics()
@@ -32,127 +42,286 @@ namespace SIRDS
 		cached_.heightF = static_cast<float>(iHeight_);
 		cached_.pmm = fPMM_;
 		cached_.bReverse = (rev_ == -1);
+
+		// z = a / (zp - b), so vd / z = (vd / a) * (zp - b). Both the separation
+		// h*es*(z - vd)/z and the right eye shift h*es*vd/z are therefore affine
+		// in zp and no divide is needed per pixel.
+		const float a = (-zNear * zFar) / (zFar - zNear);
+		const float b = 0.5f + (zNear + zFar) / (2.0f * (zFar - zNear));
+		const float hes = cached_.heightF * cached_.es;
+		const float k = cached_.vd / a;
+
+		DepthMapping& map = cached_.map;
+		map.shiftScale = hes * k;
+		map.shiftBias = -hes * k * b;
+		map.sepScale = cached_.bReverse ? map.shiftScale : -map.shiftScale;
+		map.sepBias = cached_.bReverse ? map.shiftBias - hes : hes - map.shiftBias;
 	}
 
-	float SIRDSDrawer::Lookup(float zp, int x, int& x1)
+	float SIRDSDrawer::Lookup(float zp, int x, int& x1) const
 	{
-		// Use the instance cached parameters.
 		// Caller must ensure InitStatics() was called if members have changed.
-		// Defensive fallback if vd is zero to avoid division by zero:
-		const float vd = cached_.vd != 0.f ? cached_.vd : (DPIFactor_ * fPMM_ * iViewingDistance_ / static_cast<float>(iHeight_));
-		const float es = cached_.es;
-		const float height = cached_.heightF != 0.f ? cached_.heightF : static_cast<float>(iHeight_);
-		const float centerX = cached_.centerX != 0.f ? cached_.centerX : (iWidth_ / 2.f);
-		const bool bReverse = cached_.bReverse;
-
-		float z = ((-zNear * zFar) / (zFar - zNear))
-			/ (zp - 0.5f - (zNear + zFar) / (2.0f * (zFar - zNear)));
-
-		float v;
-		if (bReverse)
-		{
-			v = height * es * (vd - z) / z;
-		}
-		else
-		{
-			v = height * es * (z - vd) / z;
-		}
-		if (x > 0) {
-			float xvd = (static_cast<float>(x) - centerX) / height;
-			xvd *= (z / vd);
-			xvd -= es;
-			xvd *= (vd / z);
-			x1 = static_cast<int>(xvd * height + centerX);
-		}
-		return v;
+		if (x > 0)
+			x1 = cached_.map.RightEyeX(zp, x);
+		return cached_.map.Separation(zp);
 	}
 
-	void SIRDSDrawer::ZBuffersToDrawer(const vector<float>& lzbuf, const vector<float>& rzbuf, int iWidth, int iHeight,
-		DrawSirdsInterface* pDrawer)
+	void SIRDSDrawer::ZBuffersToDrawer(ImageView<const float> lzbuf, ImageView<const float> rzbuf, DrawSirdsInterface* pDrawer,
+		FrameSink* sink)
+	{
+		DrawFrame(lzbuf, rzbuf, pDrawer, sink);
+	}
+
+	void SIRDSDrawer::ZBuffersToDrawer(ImageView<const uint16_t> lzbuf, ImageView<const uint16_t> rzbuf, DrawSirdsInterface* pDrawer,
+		FrameSink* sink)
+	{
+		DrawFrame(lzbuf, rzbuf, pDrawer, sink);
+	}
+
+	template <class Depth>
+	void SIRDSDrawer::DrawFrame(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer,
+		FrameSink* sink)
 	{
+		const int iWidth = lzbuf.width;
+		const int iHeight = lzbuf.height;
+		if (rzbuf.width != iWidth || rzbuf.height != iHeight)
+			throw std::invalid_argument("SIRDS depth views differ in size");
+		// Links are stored as 16 bit pixel indices.
+		if (iWidth > kMaxRowWidth)
+			throw std::invalid_argument("SIRDS row wider than kMaxRowWidth");
+
 		// Update the integer members to match the provided dimensions before init.
 		iWidth_ = iWidth;
 		iHeight_ = iHeight;
 
 		InitStatics();
-		auto& leftBuf = lzbuf;
-		auto& rightBuf = rzbuf;
+		if constexpr (std::is_same_v<Depth, uint16_t>)
+			depthTable_.Build(cached_.map);
+		pDrawer->m_Seed = bStableDots_ ? frameSeed_ : frameSeed_++;
 
-		vector<Llist> sameStart(iWidth);
-		for (int x = 0; x < iWidth; x++) {
-			sameStart[x].t = x;
-			sameStart[x].f = x;
-		}
-		if (pDrawer->InParallel())
-		{
-			parallel_for(0, iHeight, [&](int y) {
-				vector<Llist> same;
-				same = sameStart;
-				auto zll = &leftBuf[y * iWidth];
-				auto zlr = &rightBuf[y * iWidth];
-				pDrawer->sirdsnew(zll, zlr, same, iHidden_);
-				pDrawer->SirdsPicAlgo(y, same);
-			});
+		if (sink != nullptr) {
+			const PixelView target = sink->BeginFrame(iWidth, iHeight);
+			if (target.width != iWidth || target.height != iHeight)
+				throw std::invalid_argument("SIRDS sink view differs in size from the depth");
+			pDrawer->SetTarget(target);
 		}
 		else
+			pDrawer->TargetPicture();
+
+		scheduler_.SetWorkers(iWorkers_);
+		rowScratch_.resize(scheduler_.Workers());
+
+		// Only a fill that reads the row above needs the rows in order.
+		const bool rowsIndependent = pDrawer->Input() != PatternInput::PreviousRow;
+		UpdateHistory(lzbuf, rzbuf, pDrawer, rowsIndependent);
+
+		try
 		{
-			for (int y = 0; y < iHeight; y++) {
-				auto zll = &lzbuf[y * iWidth];
-				auto zlr = &rzbuf[y * iWidth];
-				vector<Llist> same;
-				same = sameStart;
-				pDrawer->sirdsnew(zll, zlr, same, iHidden_);
-				pDrawer->SirdsPicAlgo(y, same);
+			if (rowsIndependent)
+			{
+				DrawRowsBanded(lzbuf, rzbuf, pDrawer);
+			}
+			else
+			{
+				DrawRowsWavefront(lzbuf, rzbuf, pDrawer);
 			}
 		}
+		catch (...)
+		{
+			// Rows were left half drawn; the next frame must not keep them.
+			history_.drawer = nullptr;
+			throw;
+		}
 
 		pDrawer->Complete();
+		if (sink != nullptr)
+			sink->EndFrame();
 		pDrawer->SetProgress(iHeight * 3);
 	}
 
-	/* SIRDS algorithm */
-	void DrawSirdsInterface::sirdsnew(const float* zll, const float* zlr, vector<Llist>& same, bool removeHidden)
-	{
-		int xInRbuf  = 0;
-		int xNotUsed = 0;
-
-		// Get drawer instance once to call the instance Lookup method.
-		SIRDSDrawer* drawer = SIRDSDrawer::GetDrawer();
-
-		for (int left = 0; left < m_Width; left++) {
-			int s = 0;
-			if (drawer) s = static_cast<int>(drawer->Lookup(zll[left], left, xInRbuf));
-			else s = 0;
-
-			int right = left + s;
-			if (right > 0 && right < m_Width) {
-				if (xInRbuf > 0 && xInRbuf < m_Width) {
-					if (drawer)
-						s -= static_cast<int>(drawer->Lookup(zlr[xInRbuf], -1, xNotUsed));
-					else
-						s = 0;
-				}
-				else
-					s = 0;
-
-				if (!removeHidden || (s <= 3 && s >= -3)) {
-					auto sl = left;
-					auto sr = right;
-					for (auto st = same[sr].f; st != sl && st != sr; st = same[sr].f) {
-						if (st > sl) {
-							sr = st;
-						}
-						else {
-							same[sl].t = sr;
-							same[sr].f = sl;
-							sr = sl;
-							sl = st;
+	// A band fits in L2 when its pixels are as cheap as a compare. Dearer
+	// pixels get proportionally fewer rows, so a band takes about as long
+	// either way and stealing still has bands left to balance with.
+	int SIRDSDrawer::BandRows(int iWidth, int cost) const
+	{
+		const int bytesPerRow = iWidth * static_cast<int>(2 * sizeof(float) + sizeof(uint32_t));
+		if (iBandRows_ > 0)
+			return iBandRows_;
+		return std::max(1, BandScheduler::BandRowsFor(bytesPerRow) / std::max(cost, 1));
+	}
+
+	// A row whose depth matches last frame's draws the same links, so its
+	// pixels can stay as they are. Anything else that feeds the picture - the
+	// drawer, its background, the size or the depth mapping - drops the history.
+	template <class Depth>
+	void SIRDSDrawer::UpdateHistory(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf,
+		DrawSirdsInterface* pDrawer, bool rowsIndependent)
+	{
+		const int iWidth = lzbuf.width;
+		const int iHeight = lzbuf.height;
+		RowHistory& h = history_;
+		h.changed.assign(iHeight, 1);
+		if (!bReuseRows_) {
+			h.drawer = nullptr;
+			h.links.clear();
+			return;
+		}
+
+		const bool valid = h.drawer == pDrawer && h.drawerVersion == pDrawer->Version() &&
+			h.width == iWidth && h.height == iHeight && h.hidden == iHidden_ &&
+			h.depthBytes == static_cast<int>(sizeof(Depth)) && h.map == cached_.map;
+		h.drawer = pDrawer;
+		h.drawerVersion = pDrawer->Version();
+		h.width = iWidth;
+		h.height = iHeight;
+		h.hidden = iHidden_;
+		h.depthBytes = static_cast<int>(sizeof(Depth));
+		h.map = cached_.map;
+		h.fingerprint.resize(iHeight);
+
+		// Row-dependent fills redraw everything below the first changed row, but
+		// unchanged rows among those can still take their links from the cache.
+		if (rowsIndependent)
+			h.links.clear();
+		else
+			h.links.resize(static_cast<size_t>(iWidth) * iHeight);
+
+		scheduler_.ForBands(iHeight, BandRows(iWidth), [&](int, int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				const uint64_t fp = RowFingerprint(lzbuf.Row(y), rzbuf.Row(y), iWidth);
+				h.changed[y] = !valid || fp != h.fingerprint[y];
+				h.fingerprint[y] = fp;
+			}
+		});
+	}
+
+	template <class Depth>
+	void SIRDSDrawer::RowLinks(int y, RowScratch& scratch, ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf,
+		DrawSirdsInterface* pDrawer)
+	{
+		Link* cached = history_.links.empty() ? nullptr : &history_.links[static_cast<size_t>(y) * iWidth_];
+		if (cached != nullptr && !history_.changed[y]) {
+			std::copy(cached, cached + iWidth_, scratch.same.begin());
+			return;
+		}
+		ResetLinks(scratch.same.data(), iWidth_);
+		pDrawer->sirdsnew(lzbuf.Row(y), rzbuf.Row(y), scratch.seps, scratch.same, iHidden_);
+		if (cached != nullptr)
+			std::copy(scratch.same.begin(), scratch.same.begin() + iWidth_, cached);
+	}
+
+	// Independent rows go out in contiguous bands: a band's depth and output
+	// rows stay in the worker's L2, and workers that finish early steal bands
+	// from the far end of a busy worker's run.
+	template <class Depth>
+	void SIRDSDrawer::DrawRowsBanded(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer)
+	{
+		const int iWidth = lzbuf.width;
+		const int iHeight = lzbuf.height;
+		scheduler_.ForBands(iHeight, BandRows(iWidth, pDrawer->Cost()), [&](int worker, int begin, int end) {
+			RowScratch& scratch = rowScratch_[worker];
+			scratch.Prepare(iWidth);
+			for (int y = begin; y < end; y++) {
+				if (!history_.changed[y])
+					continue;
+				RowLinks(y, scratch, lzbuf, rzbuf, pDrawer);
+				pDrawer->SirdsPicAlgo(y, scratch, 0, iWidth);
+			}
+		});
+	}
+
+	// Pattern fills that read the row above cannot run rows independently, but
+	// the link building does not depend on it. Each worker claims the next row,
+	// builds its links straight away, then fills it one column tile at a time,
+	// trailing the row above by kWaveLookahead columns, or further when the
+	// drawer reads further ahead.
+	template <class Depth>
+	void SIRDSDrawer::DrawRowsWavefront(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer)
+	{
+		const int iWidth = lzbuf.width;
+		const int iHeight = lzbuf.height;
+		if (rowProgressSize_ < iHeight) {
+			rowProgress_ = std::make_unique<std::atomic<int>[]>(iHeight);
+			rowProgressSize_ = iHeight;
+		}
+
+		// Rows above the first changed one are left exactly as they are.
+		const auto firstChanged = static_cast<int>(
+			std::find(history_.changed.begin(), history_.changed.end(), 1) - history_.changed.begin());
+		for (int y = 0; y < iHeight; y++)
+			rowProgress_[y].store(y < firstChanged ? iWidth : 0, std::memory_order_relaxed);
+
+		// A tile never splits one of the fill's batches.
+		const int batch = std::max(pDrawer->BatchWidth(), 1);
+		const int tile = (kWaveTile + batch - 1) / batch * batch;
+		const int lookahead = std::max(kWaveLookahead, pDrawer->ReadAhead());
+
+		// Rows are claimed in order, so the row a worker waits on has always been
+		// claimed by a worker that is already running it.
+		std::atomic<int> nextRow{ firstChanged };
+		// Set when a worker throws; the rows it would have finished never
+		// complete, so the workers waiting on them give up instead.
+		std::atomic<bool> failed{ false };
+		scheduler_.ForWorkers([&](int worker) {
+			try {
+				RowScratch& scratch = rowScratch_[worker];
+				scratch.Prepare(iWidth);
+				for (int y = nextRow++; y < iHeight; y = nextRow++) {
+					RowLinks(y, scratch, lzbuf, rzbuf, pDrawer);
+
+					for (int begin = 0; begin < iWidth; begin += tile) {
+						const int end = std::min(iWidth, begin + tile);
+						if (y > 0) {
+							const int needed = std::min(iWidth, end + lookahead);
+							while (rowProgress_[y - 1].load(std::memory_order_acquire) < needed) {
+								if (failed.load(std::memory_order_relaxed))
+									return;
+								std::this_thread::yield();
+							}
 						}
+						pDrawer->SirdsPicAlgo(y, scratch, begin, end);
+						rowProgress_[y].store(end, std::memory_order_release);
 					}
-					same[sl].t = sr;
-					same[sr].f = sl;
 				}
 			}
-		}
+			catch (...) {
+				failed.store(true, std::memory_order_relaxed);
+				throw;
+			}
+		});
+	}
+
+	void SIRDSDrawer::VerifyLinks(RowSeparations& seps, int width) const
+	{
+		if (bVerifyLinks_ && !VerifyLinkSolvers(seps, width))
+			linkMismatches_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/* SIRDS algorithm */
+	void DrawSirdsInterface::sirdsnew(const float* zll, const float* zlr, RowSeparations& seps, vector<Link>& same, bool removeHidden)
+	{
+		// Get drawer instance once to read the cached depth conversion.
+		const SIRDSDrawer* drawer = SIRDSDrawer::GetDrawer();
+		if (drawer == nullptr)
+			return;
+
+		// All of the per-pixel arithmetic runs vectorized up front; the solver
+		// only joins the linked pairs.
+		BuildRowSeparations(zll, zlr, m_Width, drawer->GetDepthMapping(), removeHidden, seps);
+
+		drawer->VerifyLinks(seps, m_Width);
+		SolveLinks(drawer->linkSolver_, seps, m_Width, same.data());
+	}
+
+	void DrawSirdsInterface::sirdsnew(const uint16_t* zll, const uint16_t* zlr, RowSeparations& seps, vector<Link>& same, bool removeHidden)
+	{
+		const SIRDSDrawer* drawer = SIRDSDrawer::GetDrawer();
+		if (drawer == nullptr)
+			return;
+
+		BuildRowSeparations(zll, zlr, m_Width, drawer->GetDepthTable(), removeHidden, seps);
+
+		drawer->VerifyLinks(seps, m_Width);
+		SolveLinks(drawer->linkSolver_, seps, m_Width, same.data());
 	}
 }
\ No newline at end of file
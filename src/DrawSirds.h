@@ -2,7 +2,14 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include "Background.h"
+#include <atomic>
+#include <functional>
+#include "SirdsBackgroundConfig.h"
+#include "SirdsPatterns.h"
+#include "SirdsPlatform.h"
+#include "SirdsRow.h"
+#include "SirdsScheduler.h"
+#include "SirdsView.h"
 
 namespace DirectX {
 	struct Image;
@@ -11,11 +18,6 @@ namespace DirectX {
 namespace SIRDS {
 	using uschar = unsigned char;
 
-	struct Llist {
-		int t;
-		int f;
-	} ;
-
 	class DrawSirdsInterface 
 	{
 	public:
@@ -23,17 +25,49 @@ namespace SIRDS {
 		virtual void Init(SIRDS::BackgroundConfig& bg) = 0;
 		virtual void InitPicture(int width, int height, std::function<void (int)> progress)=0;
 		virtual void InitBackground(int width, int height)=0;
-		virtual void SirdsPicAlgo(int y, std::vector<SIRDS::Llist> &same)=0;
+		// Fills columns [begin, end) of row y. When Input() is PreviousRow the
+		// fill may read the row above, which is complete up to
+		// end + max(kWaveLookahead, ReadAhead()).
+		virtual void SirdsPicAlgo(int y, RowScratch &row, int begin, int end)=0;
+		// Columns past end the fill reads in the row above.
+		virtual int ReadAhead() const { return 0; }
+		// Pixels the fill works on per step; wavefront tiles are a multiple.
+		virtual int BatchWidth() const { return 1; }
+		// Rough cost of filling one unlinked pixel, 1 being a compare; bands
+		// of dearer rows are shorter.
+		virtual int Cost() const { return 1; }
 		virtual std::shared_ptr<DirectX::Image> Complete() = 0;
-		virtual bool InParallel()=0;
+		// What the fill reads, which decides the order rows are drawn in.
+		virtual PatternInput Input()=0;
+		// Pixel format of the rows SirdsPicAlgo writes.
+		virtual DXGI_FORMAT Format() const { return DXGI_FORMAT_B8G8R8X8_UNORM; }
 		virtual void SetProgress(int progress);
-		virtual void sirdsnew(const float *zll, const float *zlr, std::vector<Llist> &same,bool removeHidden);
+		virtual void sirdsnew(const float *zll, const float *zlr, RowSeparations &seps, std::vector<Link> &same, bool removeHidden);
+		virtual void sirdsnew(const uint16_t *zll, const uint16_t *zlr, RowSeparations &seps, std::vector<Link> &same, bool removeHidden);
 		std::function<void(int)> m_Progress;
 		int m_Width;
 		int m_Height;
+		uint32_t m_Seed = 0;  // random dot seed for the frame being drawn
+
+		// Marks everything drawn so far as stale; called from Init/InitPicture.
+		void Invalidate();
+		uint32_t Version() const { return m_Version; }
+
+		// Where rows are drawn. A frame drawn into a FrameSink targets the
+		// sink's buffer for that frame; a frame drawn without one calls
+		// TargetPicture, never reusing a buffer an earlier sink lent. Moving
+		// to a different buffer drops what was drawn before.
+		void SetTarget(PixelView target);
+		// Targets the drawer's own picture, leasing it on first use, so a
+		// drawer that only ever draws into a sink never allocates one.
+		virtual void TargetPicture() = 0;
+		PixelView Target() const { return m_Target; }
+	protected:
+		PixelView m_Target;
+	private:
+		uint32_t m_Version = 0;  // unique across drawers, so a reused address never matches
 	};
 
-	class Background;
 
 	class SIRDSDrawer
 	{
@@ -49,10 +83,30 @@ namespace SIRDS {
 		float DPIFactor_ = 1.0f;
 		float zShift_ = 0;	
 		bool iHidden_ = true;
+		// Seed for the next frame's random dots; advanced after every frame.
+		// Setting it reproduces a frame bit for bit.
+		uint32_t frameSeed_ = 1;
+		// Keep frameSeed_ fixed so every dot is a function of its position only:
+		// unchanged regions draw bit-identical pixels frame after frame.
+		bool bStableDots_ = false;
+		// Worker threads for the row stage, 0 for one per hardware thread.
+		int iWorkers_ = 0;
+		// Rows per scheduling band, 0 to size bands to fit in L2.
+		int iBandRows_ = 0;
+		// Keep last frame's pixels for rows whose depth did not change.
+		bool bReuseRows_ = true;
+		// How sirdsnew joins linked pixels; both give the same picture.
+		LinkSolver linkSolver_ = LinkSolver::Walk;
+		// Also run both solvers on every row and count the rows where they
+		// disagree in linkMismatches_. Slow; for checking the solvers, not
+		// for drawing.
+		bool bVerifyLinks_ = false;
+		mutable std::atomic<uint64_t> linkMismatches_{ 0 };
+
+		void VerifyLinks(RowSeparations& seps, int width) const;
 
 	protected:
 		static SIRDSDrawer *singleSIRDSDrawer;
-		Background Backbitmap;
 
 		// Cached parameters (replaces previous globals / namespace params)
 		struct CachedParameters {
@@ -63,15 +117,69 @@ namespace SIRDS {
 			float heightF = 0.f;  // float height
 			float pmm = 0.f;      // pixels per mm
 			bool bReverse = false;
+
+			// The depth linearization collapses to an affine map of the raw depth
+			// value, so separation and right-eye shift are one multiply-add each.
+			DepthMapping map;
 		};
 
 		CachedParameters cached_;
 
+		// Integer lookup for 16 bit depth, rebuilt only when the mapping changes.
+		DepthTable depthTable_;
+
+		BandScheduler scheduler_;
+
+		// Link and separation scratch, indexed by scheduler worker.
+		std::vector<RowScratch> rowScratch_;
+
+		// What was drawn last frame, so unchanged rows can be skipped.
+		struct RowHistory {
+			std::vector<uint64_t> fingerprint;  // RowFingerprint of each row's depth
+			std::vector<uint8_t> changed;       // 1 when the row must be rebuilt this frame
+			std::vector<Link> links;            // last links of every row, for row-dependent fills only
+			const DrawSirdsInterface* drawer = nullptr;
+			uint32_t drawerVersion = 0;
+			int width = 0;
+			int height = 0;
+			bool hidden = false;
+			int depthBytes = 0;                 // float or 16 bit depth
+			DepthMapping map;
+		};
+
+		RowHistory history_;
+
+		// Depth is float or uint16_t; the row stages are shared by both.
+		template <class Depth>
+		void DrawFrame(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer,
+			FrameSink* sink);
+		template <class Depth>
+		void UpdateHistory(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf,
+			DrawSirdsInterface* pDrawer, bool rowsIndependent);
+		template <class Depth>
+		void RowLinks(int y, RowScratch& scratch, ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf,
+			DrawSirdsInterface* pDrawer);
+		int BandRows(int iWidth, int cost = 1) const;
+
+		// Columns of each row already filled, used by the wavefront fill.
+		std::unique_ptr<std::atomic<int>[]> rowProgress_;
+		int rowProgressSize_ = 0;
+
+		template <class Depth>
+		void DrawRowsBanded(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer);
+		template <class Depth>
+		void DrawRowsWavefront(ImageView<const Depth> lzbuf, ImageView<const Depth> rzbuf, DrawSirdsInterface* pDrawer);
+
 		// zNear / zFar are constants used by the depth -> z conversion
 		static constexpr float zNear = 1.88976383f;
 		static constexpr float zFar  = 4.15748024f;
 
 	public:
+		// Column tile width of the wavefront fill, and how far the row above
+		// must be ahead of the tile being filled.
+		static constexpr int kWaveTile = 256;
+		static constexpr int kWaveLookahead = kWaveTile;
+
 		static SIRDSDrawer * GetDrawer() { return singleSIRDSDrawer; }
 
 		SIRDSDrawer()
@@ -80,18 +188,44 @@ namespace SIRDS {
 			// Some default parameters
 		}
 
+		// Depth comes in as strided views, so captured or mapped buffers are
+		// read in place; both eyes must be the same size. With a sink the rows
+		// are drawn straight into the sink's buffer instead of the drawer's.
+		void ZBuffersToDrawer(ImageView<const float> lzbuf, ImageView<const float> rzbuf, DrawSirdsInterface *pDrawer,
+			FrameSink *sink = nullptr);
+		// 16 bit UNORM depth, as read back from a D16 depth buffer. The row setup
+		// goes through an integer table instead of float arithmetic.
+		void ZBuffersToDrawer(ImageView<const uint16_t> lzbuf, ImageView<const uint16_t> rzbuf, DrawSirdsInterface *pDrawer,
+			FrameSink *sink = nullptr);
 		void ZBuffersToDrawer(const std::vector<float> &lzbuf, const std::vector<float> &rzbuf, int width, int height,
-			DrawSirdsInterface *pDrawer);
+			DrawSirdsInterface *pDrawer)
+		{
+			ZBuffersToDrawer(ViewOf(lzbuf, width, height), ViewOf(rzbuf, width, height), pDrawer);
+		}
+		void ZBuffersToDrawer(const std::vector<uint16_t> &lzbuf, const std::vector<uint16_t> &rzbuf, int width, int height,
+			DrawSirdsInterface *pDrawer)
+		{
+			ZBuffersToDrawer(ViewOf(lzbuf, width, height), ViewOf(rzbuf, width, height), pDrawer);
+		}
 		// Lookup is now an instance method that uses `cached_` populated by InitStatics.
-		float Lookup(float value, int x, int& x1);
+		float Lookup(float value, int x, int& x1) const;
 		void InitStatics();
-		bool SafeToSelectObject([[maybe_unused]] int nShapes) const{
-			return true;
+		// Forces every row to be redrawn on the next frame.
+		void InvalidateHistory()
+		{
+			history_.drawer = nullptr;
 		}
 
-		Background &GetBackground()
+		const DepthMapping& GetDepthMapping() const
+		{
+			return cached_.map;
+		}
+		const DepthTable& GetDepthTable() const
 		{
-			return Backbitmap;
+			return depthTable_;
+		}
+		bool SafeToSelectObject([[maybe_unused]] int nShapes) const{
+			return true;
 		}
 	};
 }
\ No newline at end of file
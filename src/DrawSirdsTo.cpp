@@ -4,14 +4,49 @@
 
 #include "DrawSirdsTo.h"
 #include <algorithm>
-#include <cmath>
 #include <cstring>          // <- added for memcpy
 #include "Voronoi.h"
+#include "SirdsAutomaton.h"
+#include "SirdsRandom.h"
+#include "SirdsFramePool.h"
+#include "SirdsPicture.h"
 
 using namespace std;
 using namespace SIRDS;
 using namespace Voronoi;
 
+// A picture whose pixels are leased from the shared frame pool. The lease
+// lives as long as the last reference to the picture, so a frame still held
+// by a consumer is never handed out again, and the buffer returns to the pool
+// instead of leaking when the drawer is re-initialised.
+std::shared_ptr<DirectX::Image> SIRDS::LeasePicture(int width, int height, DXGI_FORMAT format)
+{
+	auto lease = make_shared<FrameLease>(FramePool::Shared().Acquire(width, height, format, sizeof(UINT32)));
+	std::shared_ptr<DirectX::Image> image(new DirectX::Image(), [lease](DirectX::Image* p) { delete p; });
+	image->width = width;
+	image->height = height;
+	image->format = format;
+	image->rowPitch = lease->RowPitch();
+	image->slicePitch = lease->Size();
+	image->pixels = lease->Data();
+	return image;
+}
+
+std::shared_ptr<DirectX::Image> SIRDS::TargetImage(const std::shared_ptr<DirectX::Image>& own, const PixelView& target,
+	DXGI_FORMAT format)
+{
+	if (target.data == nullptr || (own != nullptr && reinterpret_cast<uint8_t*>(target.data) == own->pixels))
+		return own;
+	auto image = make_shared<DirectX::Image>();
+	image->width = target.width;
+	image->height = target.height;
+	image->format = format;
+	image->pixels = reinterpret_cast<uint8_t*>(target.data);
+	image->rowPitch = target.rowPitch;
+	image->slicePitch = target.rowPitch * image->height;
+	return image;
+}
+
 DrawSIRDSToBitmap::DrawSIRDSToBitmap() = default;
 
 void DrawSIRDSToBitmap::Init(SIRDS::BackgroundConfig& bg)
@@ -20,23 +55,72 @@ void DrawSIRDSToBitmap::Init(SIRDS::BackgroundConfig& bg)
 	m_Density2 = bg.density2_;
 	m_WolframNumber = bg.wolframNumber_;
 	m_Method = bg.method_;
-	m_PixelSize = bg.pixelSize_;
+	m_PixelSize = std::max(bg.pixelSize_, 1);
 	color1 = bg.color1_;
 	color2 = bg.color2_;
 	color3 = bg.color3_;
+	m_Config = bg;
+	m_Info = FindPattern(m_Method);
+	m_Kernel = m_Info != nullptr ? m_Info->kernel(bg) : nullptr;
+	const auto rule3 = TotalisticRule3(m_WolframNumber);
+	const UINT32 colors[3] = { color1, color2, color3 };
+	for (size_t v = 0; v < rule3.size(); v++)
+		m_Rule3[v] = colors[rule3[v]];
+	// Voronoi tile size in pixels and site seed.
+	m_Stones.Reset(std::max(8.0f, float(m_PixelSize * 6)), int(m_WolframNumber & 0x7FFF), color1, color2, color3);
+	m_Pattern.Reset();
+	Invalidate();
 }
 
 DrawSIRDSToBitmap::~DrawSIRDSToBitmap() = default;
 
-bool DrawSIRDSToBitmap::InParallel()
+PatternInput DrawSIRDSToBitmap::Input()
+{
+	return m_Info != nullptr ? m_Info->input(m_Config) : PatternInput::None;
+}
+
+int DrawSIRDSToBitmap::ReadAhead() const
+{
+	return m_Info != nullptr && m_Info->readAhead != nullptr ? m_Info->readAhead(m_Config) : 0;
+}
+
+int DrawSIRDSToBitmap::BatchWidth() const
+{
+	return m_Info != nullptr ? m_Info->batchWidth : 1;
+}
+
+// A pattern drawn once by RenderPattern costs a fetch per pixel.
+int DrawSIRDSToBitmap::Cost() const
 {
-	return m_Method == 1 && m_PixelSize == 1 && m_Density2==0;
+	return m_Info != nullptr && !m_Pattern ? m_Info->cost : 1;
 }
 
 void DrawSIRDSToBitmap::InitBackground(int width, int height)
 {
-	(void)width;	// Unused parameter
-	(void)height;	// Unused parameter
+	m_Pattern.Reset();
+	if (m_Info != nullptr && m_Info->prepare != nullptr)
+		m_Info->prepare(*this, width, height);
+	if (m_Kernel != nullptr && m_Info != nullptr && m_Info->Cacheable(m_Config))
+		RenderPattern(width, height);
+}
+
+// Draws the background once for patterns that declare the same pixels every
+// frame, so a frame only has to fetch them. The row kernel does the drawing,
+// with every pixel unlinked, into a buffer of its own.
+void DrawSIRDSToBitmap::RenderPattern(int width, int height)
+{
+	m_Pattern = FramePool::Shared().Acquire(width, height, Format());
+	const PixelView target = m_Target;
+	m_Width = width;
+	m_Height = height;
+	SetTarget(m_Pattern.Pixels());
+
+	SIRDS::RowScratch row;
+	row.Prepare(width);
+	ResetLinks(row.same.data(), width);
+	for (int y = 0; y < height; y++)
+		m_Kernel(*this, y, row, 0, width);
+	SetTarget(target);
 }
 
 void DrawSIRDSToBitmap::InitPicture(int width, int height, std::function<void(int)> progress)
@@ -45,317 +129,368 @@ void DrawSIRDSToBitmap::InitPicture(int width, int height, std::function<void(in
 	m_Width = width;
 	m_Progress = progress;
 
-	m_picture = make_shared<DirectX::Image>();
-	m_picture->height = height;
-	m_picture->width = width;
-	m_picture->format = DXGI_FORMAT_B8G8R8X8_UNORM;
-	m_picture->rowPitch = width*sizeof(UINT);
-	m_picture->slicePitch = m_picture->rowPitch * m_picture->height;
-	m_picture->pixels = new BYTE[m_picture->slicePitch];
-	m_Progress = progress;
+	// Leased by TargetPicture when a frame is drawn without a sink.
+	m_picture.reset();
+	SetTarget(PixelView());
 }
 
-void DrawSIRDSToBitmap::SirdsPicAlgo1(int y, std::vector<SIRDS::Llist> &same)
+void DrawSIRDSToBitmap::TargetPicture()
 {
-	auto *pv = reinterpret_cast<UINT32 *>(m_picture->pixels);
-	auto*pa = &pv[y * m_Width];
-	UINT32 *pam1 = nullptr;
-	if (y != 0)
-		pam1 = &pv[(y - 1) * m_Width];
-	for (UINT x = 0; x < same.size(); x++) {
-		if (UINT pixpos = same[x].f;
-			pixpos != x){
-			pa[x] = pa[pixpos];
+	if (m_picture == nullptr)
+		m_picture = LeasePicture(m_Width, m_Height, Format());
+	SetTarget(PixelView(reinterpret_cast<uint32_t*>(m_picture->pixels), m_Width, m_Height, m_picture->rowPitch));
+}
+
+namespace {
+	// Tracks the start of the pixelSize block containing x without % or /.
+	// PixelSize 1, 2 and 4 are folded into masks; 0 means the size is only
+	// known at run time and the cursor is advanced once per pixel instead.
+	template <int PixelSize>
+	struct BlockCursor {
+		BlockCursor(int, int) {}
+		int Start(int x) const
+		{
+			if constexpr (PixelSize == 1)
+				return x;
+			else
+				return x & ~(PixelSize - 1);
+		}
+		void Next() {}
+		void Skip(int) {}
+	};
+
+	template <>
+	struct BlockCursor<0> {
+		BlockCursor(int pixelSize, int x) : size(pixelSize), phase(x % pixelSize), start(x - phase) {}
+		int Start(int) const { return start; }
+		void Next()
+		{
+			if (++phase == size) {
+				phase = 0;
+				start += size;
+			}
+		}
+		// Advances n pixels at once; only used after a whole linked run.
+		void Skip(int n)
+		{
+			phase += n;
+			if (phase >= size) {
+				const int blocks = phase / size;
+				phase -= blocks * size;
+				start += blocks * size;
+			}
+		}
+		int size;
+		int phase;
+		int start;
+	};
+
+	inline int PixelSizeOf(int templateSize, int runtimeSize)
+	{
+		return templateSize != 0 ? templateSize : runtimeSize;
+	}
+}
+
+template <int PixelSize, bool Density2>
+void DrawSIRDSToBitmap::SirdsPicAlgo1(int y, SIRDS::RowScratch &row, int begin, int end)
+{
+	const int ps = PixelSizeOf(PixelSize, m_PixelSize);
+	UINT32* pa = m_Target.Row(y);
+	UINT32* pam1 = y != 0 ? m_Target.Row(y - 1) : nullptr;
+	// Rows inside a pixel block repeat the block's first row.
+	const bool repeatRow = PixelSize != 1 && pam1 != nullptr && (y % ps) != 0;
+	BlockCursor<PixelSize> block(ps, begin);
+	const auto& same = row.same;
+	const uint16_t* dots = row.dots.data();
+	if (!repeatRow)
+		DotRandom::FillRow(m_Seed, y, begin, end, row.dots.data());
+	for (int x = begin; x < end; x++, block.Next()) {
+		if (same[x] != x) {
+			const int next = CopyLinkedRun(pa, same.data(), x, end);
+			block.Skip(next - x - 1);
+			x = next - 1;
 			continue;
 		}
-		if (pam1 != nullptr && !(y % m_PixelSize == 0)) {
-			pa[x] = pam1[m_PixelSize*(int)(x / m_PixelSize)];
+		const int bx = block.Start(x);
+		if (repeatRow) {
+			pa[x] = pam1[bx];
 			continue;
 		}
-		if (!(x % m_PixelSize == 0)) {
-			pa[x] = pa[m_PixelSize*(int)(x / m_PixelSize)];
+		if (bx != x) {
+			pa[x] = pa[bx];
 			continue;
 		}
-		if (m_Density2 != 0 && y != 0 && 
-			(rand() & 0xff) < m_Density2){
+		if constexpr (Density2) {
+			if (pam1 != nullptr &&
+				(dots[x] >> 8) < m_Density2) {
 				pa[x] = pam1[x];
 				continue;
+			}
 		}
-		pa[x] = (((rand() & 0xff) > m_Density) ? color1 : color2);
+		pa[x] = (((dots[x] & 0xff) > m_Density) ? color1 : color2);
 	}
 }
 
-void DrawSIRDSToBitmap::SirdsPicAlgo2(int y, std::vector<SIRDS::Llist> &same)
+template <int PixelSize>
+void DrawSIRDSToBitmap::SirdsPicAlgo2(int y, SIRDS::RowScratch &row, int begin, int end)
 {
-	auto *pv = reinterpret_cast<UINT32 *>(m_picture->pixels);
-	auto *pa = &pv[y * m_Width];
-	UINT32 *pam1 = nullptr;
-	if (y != 0)
-		pam1 = &pv[(y - 1) * m_Width];
-	for (UINT x = 0; x < same.size(); x++) {
-		UINT pixpos = same[x].f;
-		if (pixpos != x)
-			pa[x] = pa[pixpos];
+	const int ps = PixelSizeOf(PixelSize, m_PixelSize);
+	UINT32* pa = m_Target.Row(y);
+	UINT32* pam1 = y != 0 ? m_Target.Row(y - 1) : nullptr;
+	const bool repeatRow = PixelSize != 1 && pam1 != nullptr && (y % ps) != 0;
+	BlockCursor<PixelSize> block(ps, begin);
+	const auto& same = row.same;
+	const uint16_t* dots = row.dots.data();
+	if (!repeatRow)
+		DotRandom::FillRow(m_Seed, y, begin, end, row.dots.data());
+	for (int x = begin; x < end; x++, block.Next()) {
+		if (same[x] != x) {
+			const int next = CopyLinkedRun(pa, same.data(), x, end);
+			block.Skip(next - x - 1);
+			x = next - 1;
+		}
 		else
 		{
-			if (!(x % m_PixelSize == 0)) {
-				pa[x] = pa[m_PixelSize*(int)(x / m_PixelSize)];
+			const int bx = block.Start(x);
+			if (bx != x) {
+				pa[x] = pa[bx];
 				continue;
 			}
-			if (pam1 != nullptr &&
-				!(y % m_PixelSize == 0)) {
-				pa[x] = pam1[m_PixelSize*(int)(x / m_PixelSize)];
+			if (repeatRow) {
+				pa[x] = pam1[x];
 				continue;
 			}
-			pa[x] = (((rand() & 0xff) > m_Density) ? color1 : color2);
+			pa[x] = (((dots[x] & 0xff) > m_Density) ? color1 : color2);
 		}
 	}
 }
 
-void DrawSIRDSToBitmap::SirdsPicWolfram(int y, std::vector<SIRDS::Llist> &same)
+template <int PixelSize>
+void DrawSIRDSToBitmap::SirdsPicWolfram(int y, SIRDS::RowScratch &row, int begin, int end)
 {
-	auto *pv = reinterpret_cast<UINT32 *>(m_picture->pixels);
-	auto *pa = &pv[y * m_Width];
-	UINT32 *pam1 = nullptr;
-	if (y != 0)
-		pam1 = &pv[(y - 1) * m_Width];
-	int x1{ 0 };
-	int x2{ 0 };
-	int x3{ 0 };
-	for (UINT x = 0; x < same.size(); x++) {
-		UINT pixpos = same[x].f;
-		if (pixpos != x)
-			pa[x] = pa[pixpos];
+	const int ps = PixelSizeOf(PixelSize, m_PixelSize);
+	UINT32* pa = m_Target.Row(y);
+	UINT32* pam1 = y != 0 ? m_Target.Row(y - 1) : nullptr;
+	const bool repeatRow = PixelSize != 1 && (y % ps) != 0;
+	// Neighbour cells are clamped to the first and last block of the row.
+	const int lastBlock = (m_Width - 1) - (m_Width - 1) % ps;
+	BlockCursor<PixelSize> block(ps, begin);
+	const auto& same = row.same;
+	// Only the first row is seeded at random; the automaton grows from it.
+	const uint16_t* dots = row.dots.data();
+	if (pam1 == nullptr)
+		DotRandom::FillRow(m_Seed, y, begin, end, row.dots.data());
+
+	// The next generation for the whole tile, 64 cells per step: cell x - begin
+	// from the row above's cells x - ps, x and x + ps. Packing reads up to
+	// ps + 63 pixels past end, see WolframReadAhead.
+	const uint64_t* generation = nullptr;
+	if (pam1 != nullptr && !repeatRow) {
+		const int words = Automaton::Words(end - begin);
+		const int cellCount = words * Automaton::kCellsPerWord + 2 * ps;
+		const size_t cellWords = Automaton::Words(cellCount);
+		if (row.cells.size() < cellWords + words)
+			row.cells.resize(cellWords + words);
+		uint64_t* cells = row.cells.data();
+		Automaton::Pack(pam1, color1, begin - ps, lastBlock, cellCount, cells);
+		Automaton::Step(cells, ps, m_WolframNumber, words, cells + cellWords);
+		generation = cells + cellWords;
+	}
+	for (int x = begin; x < end; x++, block.Next()) {
+		if (same[x] != x) {
+			const int next = CopyLinkedRun(pa, same.data(), x, end);
+			block.Skip(next - x - 1);
+			x = next - 1;
+		}
 		else
 		{
-			if (!(x % m_PixelSize == 0)) {
+			if (block.Start(x) != x) {
 				pa[x] = pa[x - 1];
 				continue;
 			}
 			if (pam1 != nullptr)
 			{
-				if (!(y % m_PixelSize == 0)) {
+				if (repeatRow) {
 					pa[x] = pam1[x];
 					continue;
 				}
-				x1 = pam1[std::max(m_PixelSize*(int)((x - m_PixelSize) / m_PixelSize), 0)] == color1 ? 0 : 1;
-				x2 = pam1[x] == color1 ? 0 : 1;
-				x3 = pam1[std::min(m_PixelSize*(int)((x + m_PixelSize) / m_PixelSize), m_Width)] == color1 ? 0 : 1;
-				auto v = x1 + x2 * 2 + x3 * 4;
-				if (auto b = 1 << v;
-				(b & m_WolframNumber) == 0)
-					pa[x] = color1;
-				else
-					pa[x] = color2;
+				const int i = x - begin;
+				pa[x] = ((generation[i >> 6] >> (i & 63)) & 1) ? color2 : color1;
 				continue;
 			}
-			pa[x] = (((rand() & 0xff) > m_Density) ? color1 : color2);
+			pa[x] = (((dots[x] & 0xff) > m_Density) ? color1 : color2);
 		}
 	}
 }
 
-void DrawSIRDSToBitmap::SirdsPicWolfram3(int y, std::vector<SIRDS::Llist> &same)
+template <int PixelSize>
+void DrawSIRDSToBitmap::SirdsPicWolfram3(int y, SIRDS::RowScratch &row, int begin, int end)
 {
-	UINT32* pv = reinterpret_cast<UINT32*>(m_picture->pixels);
-	UINT32* pa = &pv[y * m_Width];
-	UINT32* pam1 = nullptr;
-	if (y != 0)
-		pam1 = &pv[(y - 1) * m_Width];
+	const int ps = PixelSizeOf(PixelSize, m_PixelSize);
+	UINT32* pa = m_Target.Row(y);
+	UINT32* pam1 = y != 0 ? m_Target.Row(y - 1) : nullptr;
+	const bool repeatRow = PixelSize != 1 && (y % ps) != 0;
+	const int lastBlock = (m_Width - 1) - (m_Width - 1) % ps;
+	BlockCursor<PixelSize> block(ps, begin);
 	int x1(0), x2(0), x3(0);
-	for (UINT x = 0; x < same.size(); x++) {
-		UINT pixpos = same[x].f;
-		if (pixpos != x)
-			pa[x] = pa[pixpos];
+	const auto& same = row.same;
+	// Only the first row is seeded at random; the automaton grows from it.
+	const uint16_t* dots = row.dots.data();
+	if (pam1 == nullptr)
+		DotRandom::FillRow(m_Seed, y, begin, end, row.dots.data());
+	for (int x = begin; x < end; x++, block.Next()) {
+		if (same[x] != x) {
+			const int next = CopyLinkedRun(pa, same.data(), x, end);
+			block.Skip(next - x - 1);
+			x = next - 1;
+		}
 		else
 		{
-			if (!(x % m_PixelSize == 0)) {
+			if (block.Start(x) != x) {
 				pa[x] = pa[x - 1];
 				continue;
 			}
 			if (pam1 != nullptr)
 			{
-				if (!(y % m_PixelSize == 0)) {
+				if (repeatRow) {
 					pa[x] = pam1[x];
 					continue;
 				}
-				auto pm1Col = pam1[std::max(m_PixelSize * (int)((x - m_PixelSize) / m_PixelSize), 0)];
-				x1 = pm1Col == color1 ? 0 : pm1Col == color2 ? 1 : 2;
-				auto pCol = pam1[x];
-				x2 = pCol == color1 ? 0 : pCol == color2 ? 1 : 2;
-				auto pp1Col = pam1[std::min(m_PixelSize * (int)((x + m_PixelSize) / m_PixelSize), m_Width)];
-				x3 = pp1Col == color1 ? 0 : pCol == color2 ? 1 : 2;
-
-				auto v = x1 + x2 + x3;
-				int b = (int)pow(3, v);
-				int c = 0;
-				for (int i = 0; i < 7; i++)
-				{
-					int p = (int)pow(3, i);
-					int r = int(b / p) % 3;
-					int s = int(m_WolframNumber / p) % 3;
-					if (r == 1) {
-						c = s;
-						break;
-					}
-				}
-				if (c == 0)
-					pa[x] = color1;
-				else if (c == 1)
-					pa[x] = color2;
-				else
-					pa[x] = color3;
-
+				x1 = State3(pam1[std::max(x - ps, 0)]);
+				x2 = State3(pam1[x]);
+				x3 = State3(pam1[std::min(x + ps, lastBlock)]);
+				pa[x] = m_Rule3[x1 + x2 + x3];
 				continue;
 			}
-			auto col = rand() & 0xff;
+			auto col = dots[x] & 0xff;
 			pa[x] = ((col < 85) ? color1 : (col < 190) ? color2 : color3);
 		}
 	}
 }
 
-void DrawSIRDSToBitmap::SirdsPicAlgo(int y, std::vector<SIRDS::Llist> &same)
-{
-	switch (m_Method)
+namespace {
+	// Adapts a row kernel member to a RowKernel.
+	template <auto Kernel>
+	void CallKernel(DrawSirdsInterface& drawer, int y, SIRDS::RowScratch& row, int begin, int end)
 	{
-	case 1:
-		SirdsPicAlgo1(y, same);
-		break;
-	case 2:
-		SirdsPicAlgo2(y, same);
-		break;
-	case 3:
-		SirdsPicWolfram(y, same);
-		break;
-	case 4:
-		SirdsPicWolfram3(y, same);
-		break;
-	case 5:
-		SirdsPicVoronoi(y, same);
-		break;
+		(static_cast<DrawSIRDSToBitmap&>(drawer).*Kernel)(y, row, begin, end);
 	}
-}
 
-std::shared_ptr<DirectX::Image> DrawSIRDSToBitmap::Complete()
-{
-	return m_picture;
+	// Kernel sets are indexed by pixel size 1, 2, 4 and then the generic
+	// run-time size.
+	int SizeColumn(const BackgroundConfig& bg)
+	{
+		const int ps = std::max(bg.pixelSize_, 1);
+		return ps == 1 ? 0 : ps == 2 ? 1 : ps == 4 ? 2 : 3;
+	}
 }
 
-
-DrawSIRDSToColorBitmap::DrawSIRDSToColorBitmap(SIRDS::Background& bg) :
-	m_backgroundImage(bg.backgroundImage_),
-	m_scaledBackgroundImage()
+RowKernel DrawSIRDSToBitmap::DotsKernel(const BackgroundConfig& bg)
 {
-	//m_backgroundImage = bg.backgroundImage_;
+	static constexpr RowKernel plain[] = {
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<1, false>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<2, false>>,
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<4, false>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<0, false>> };
+	static constexpr RowKernel density2[] = {
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<1, true>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<2, true>>,
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<4, true>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo1<0, true>> };
+	return (bg.density2_ != 0 ? density2 : plain)[SizeColumn(bg)];
 }
 
-DrawSIRDSToColorBitmap::~DrawSIRDSToColorBitmap()
+RowKernel DrawSIRDSToBitmap::Dots2Kernel(const BackgroundConfig& bg)
 {
+	static constexpr RowKernel kernels[] = {
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo2<1>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo2<2>>,
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo2<4>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicAlgo2<0>> };
+	return kernels[SizeColumn(bg)];
 }
 
-void DrawSIRDSToColorBitmap::Init(SIRDS::BackgroundConfig& bg)
+RowKernel DrawSIRDSToBitmap::WolframKernel(const BackgroundConfig& bg)
 {
-
+	static constexpr RowKernel kernels[] = {
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram<1>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram<2>>,
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram<4>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram<0>> };
+	return kernels[SizeColumn(bg)];
 }
 
-bool DrawSIRDSToColorBitmap::InParallel()
+RowKernel DrawSIRDSToBitmap::Wolfram3Kernel(const BackgroundConfig& bg)
 {
-	return true;
+	static constexpr RowKernel kernels[] = {
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram3<1>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram3<2>>,
+		CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram3<4>>, CallKernel<&DrawSIRDSToBitmap::SirdsPicWolfram3<0>> };
+	return kernels[SizeColumn(bg)];
 }
 
-void DrawSIRDSToColorBitmap::InitBackground(int width, int height)
+RowKernel DrawSIRDSToBitmap::VoronoiKernel(const BackgroundConfig&)
 {
-	m_BackgroundWidth = width;
-	m_BackgroundHeight = height;
-
-	m_Width = width;
-	m_Height = height;
-
-	DirectX::Resize(m_backgroundImage.GetImages(), 1, m_backgroundImage.GetMetadata(), width, height, 
-		DirectX::TEX_FILTER_FORCE_WIC, m_scaledBackgroundImage);
+	return CallKernel<&DrawSIRDSToBitmap::SirdsPicVoronoi>;
 }
 
-void DrawSIRDSToColorBitmap::InitPicture(int width, int height, std::function<void(int)> progress)
+void DrawSIRDSToBitmap::SirdsPicAlgo(int y, SIRDS::RowScratch &row, int begin, int end)
 {
-	m_picture = make_shared<DirectX::Image>();
-	m_picture->height = height;
-	m_picture->width = width;
-	m_picture->format = m_scaledBackgroundImage.GetMetadata().format;
-	m_picture->rowPitch = width*sizeof(UINT);
-	m_picture->slicePitch = m_picture->rowPitch * m_picture->height;
-	m_picture->pixels = new BYTE[m_picture->slicePitch];
-	m_Progress = progress;
-
-	pv = m_scaledBackgroundImage.GetPixels();
-	if (pv == nullptr)
-		throw PictureNotFound("No background defined");
+	if (m_Pattern && m_Pattern.Width() == m_Target.width && m_Pattern.Height() == m_Target.height)
+		SirdsPicPattern(y, row, begin, end);
+	else if (m_Kernel != nullptr)
+		m_Kernel(*this, y, row, begin, end);
 }
 
-void DrawSIRDSToColorBitmap::SirdsPicAlgo(int y, std::vector<SIRDS::Llist> &same)
+// Unlinked pixels come from the background RenderPattern drew, as
+// DrawSIRDSToColorBitmap does with a bitmap.
+void DrawSIRDSToBitmap::SirdsPicPattern(int y, SIRDS::RowScratch &row, int begin, int end)
 {
-	auto pa0 = reinterpret_cast<int32_t*>(m_picture->pixels);
-	auto paback = reinterpret_cast<int32_t*>(pv);
-	auto pa = &pa0[y * m_Width];
-	auto pBackGround = &paback[(y % m_BackgroundHeight) * m_BackgroundWidth];
-
-	for (int x = 0; x<same.size(); x++) {
-		auto pixpos = same[x].f;
-		if (pixpos != x)
-			pa[x] = pa[pixpos];
+	UINT32* pa = m_Target.Row(y);
+	const UINT32* pattern = m_Pattern.Pixels().Row(y);
+	const auto& same = row.same;
+
+	for (int x = begin; x < end; x++) {
+		if (same[x] != x)
+			x = CopyLinkedRun(pa, same.data(), x, end) - 1;
 		else
-			pa[x] = pBackGround[x % m_BackgroundWidth];
+			pa[x] = pattern[x];
 	}
 }
 
-std::shared_ptr<DirectX::Image> DrawSIRDSToColorBitmap::Complete()
+std::shared_ptr<DirectX::Image> DrawSIRDSToBitmap::Complete()
 {
-	return m_picture;
+	return TargetImage(m_picture, m_Target, Format());
 }
 
+
 // Voronoi-based "stone" tiles. Uses Voronoi cell distribution, per-cell hue
 // variation and a thin crack line where distance to site is near border.
-void DrawSIRDSToBitmap::SirdsPicVoronoi(int y, std::vector<SIRDS::Llist>& same)
+// Unlinked pixels are shaded together first, eight per SIMD step; linked
+// pixels then copy from the left as in the other kernels.
+void DrawSIRDSToBitmap::SirdsPicVoronoi(int y, SIRDS::RowScratch& row, int begin, int end)
 {
-	auto* pv = reinterpret_cast<UINT32*>(m_picture->pixels);
-	auto* pa = &pv[y * m_Width];
-	UINT32* pam1 = nullptr;
-	if (y != 0)
-		pam1 = &pv[(y - 1) * m_Width];
-
-	const float cellSize = std::max(8.0f, float(m_PixelSize * 6)); // tile size in pixels (tunable)
-	const int seed = int(m_WolframNumber & 0x7FFF);
-	const float crackWidth = 0.9f; // how wide cracks appear (tunable)
-
-	for (UINT x = 0; x < same.size(); x++) {
-		UINT pixpos = same[x].f;
-		if (pixpos != x) {
-			pa[x] = pa[pixpos];
-			continue;
-
+	UINT32* pa = m_Target.Row(y);
+	const auto& same = row.same;
+
+	if (!m_Stones.Covers(m_Target.width, m_Target.height)) {
+		// Not the size InitBackground cached sites for.
+		for (int x = begin; x < end; x++) {
+			if (same[x] != x)
+				x = CopyLinkedRun(pa, same.data(), x, end) - 1;
+			else
+				pa[x] = m_Stones.ShadeUncached(x, y);
 		}
+		return;
+	}
 
-		// Compute Voronoi nearest site and distance
-		float dist; uint32_t siteHash;
-		VoronoiNearest(float(x) + 0.5f, float(y) + 0.5f, cellSize, seed, dist, siteHash);
-
-		// Normalize distance: max distance to consider ~ cellSize*0.8
-		float t = dist / (cellSize * 0.8f);
-		if (t > 1.0f) t = 1.0f;
-
-		// Determine base stone color per site (use siteHash to perturb color)
-		// Mix color1/color2/color3 subtly per site
-		float h = (siteHash & 0xFFFF) / float(0x10000);
-		uint32_t base = (h < 0.5f) ? LerpColor(color1, color2, h * 2.0f) : LerpColor(color2, color3, (h - 0.5f) * 2.0f);
-
-		// Darken near cracks: where t is close to 0.5 create thin dark lines
-		float crackFactor = fabsf(t - 0.5f) * 2.0f; // 0 at center of crack, 1 away
-		// Make cracks darker: invert crackFactor and apply threshold
-		float crack = 1.0f - std::min(1.0f, crackFactor * (1.0f / crackWidth));
-
-		// Combine base color with a darker tone based on crack
-		uint32_t darkTone = LerpColor(base, 0xFF000000u | (base & 0x00FFFFFFu), 0.45f);
-		uint32_t final = LerpColor(base, darkTone, crack * 0.8f);
-
-		pa[x] = final;
+	SIRDS::Link* columns = row.freeColumns.data();
+	int count = 0;
+	for (int x = begin; x < end; x++) {
+		if (same[x] == x)
+			columns[count++] = static_cast<SIRDS::Link>(x);
+	}
+	m_Stones.Shade(y, columns, count, pa);
 
+	for (int x = begin; x < end; x++) {
+		if (same[x] != x)
+			x = CopyLinkedRun(pa, same.data(), x, end) - 1;
 	}
-}
\ No newline at end of file
+}
+
+// Sites for the size about to be drawn, so rows only shade.
+void DrawSIRDSToBitmap::BuildStones(DrawSirdsInterface& drawer, int width, int height)
+{
+	static_cast<DrawSIRDSToBitmap&>(drawer).m_Stones.Build(width, height);
+}
@@ -1,18 +1,31 @@
 #pragma once
 
-#include "Background.h"
+#include <array>
 #include <vector>
-#include "SirdsUtils.h"
 #include "DrawSirds.h"
+#include "SirdsFramePool.h"
+#include "Voronoi.h"
 
 namespace SIRDS {
-	struct PictureNotFound : public std::exception {
-		using std::exception::exception;
-	};
+	// Totalistic 3-colour automaton: the next cell is base-3 digit v of the
+	// rule, v being the sum of the three cells above (0..6). Digits other than
+	// 0 and 1, including those of a negative rule, pick the third colour.
+	constexpr std::array<uint8_t, 7> TotalisticRule3(int rule)
+	{
+		std::array<uint8_t, 7> next{};
+		int p = 1;
+		for (size_t v = 0; v < next.size(); v++, p *= 3) {
+			const int digit = (rule / p) % 3;
+			next[v] = static_cast<uint8_t>(digit == 0 ? 0 : digit == 1 ? 1 : 2);
+		}
+		return next;
+	}
 
 	class DrawSIRDSToBitmap : public SIRDS::DrawSirdsInterface
 	{
 		std::shared_ptr<DirectX::Image> m_picture;
+		SIRDS::BackgroundConfig m_Config;
+		const SIRDS::PatternInfo* m_Info = nullptr;  // registry entry for m_Method
 		int m_Density;
 		int m_Density2;
 		int m_WolframNumber;
@@ -21,42 +34,48 @@ namespace SIRDS {
 		UINT32 color1;
 		UINT32 color2;
 		UINT32 color3;
+		UINT32 m_Rule3[7] = {};  // method 4: colour for each neighbourhood sum
+		SIRDS::RowKernel m_Kernel = nullptr;
+		Voronoi::StoneGrid m_Stones;  // sites for voronoi, built by BuildStones
+		SIRDS::FrameLease m_Pattern;  // the whole background, for patterns that are Cacheable()
+
+		// Row kernels specialised on pixel size (0 = run-time size) and density2,
+		// picked once per background by the registry's kernel factory.
+		template <int PixelSize, bool Density2>
+		void SirdsPicAlgo1(int y, SIRDS::RowScratch &row, int begin, int end);
+		template <int PixelSize>
+		void SirdsPicAlgo2(int y, SIRDS::RowScratch &row, int begin, int end);
+		template <int PixelSize>
+		void SirdsPicWolfram(int y, SIRDS::RowScratch &row, int begin, int end);
+		template <int PixelSize>
+		void SirdsPicWolfram3(int y, SIRDS::RowScratch &row, int begin, int end);
+		int State3(UINT32 c) const { return c == color1 ? 0 : c == color2 ? 1 : 2; }
+		void RenderPattern(int width, int height);
+		void SirdsPicPattern(int y, SIRDS::RowScratch &row, int begin, int end);
 	public:
+		// PatternInfo hooks for the patterns this drawer draws. The kernels
+		// and BuildStones expect a DrawSIRDSToBitmap.
+		static SIRDS::RowKernel DotsKernel(const SIRDS::BackgroundConfig& bg);
+		static SIRDS::RowKernel Dots2Kernel(const SIRDS::BackgroundConfig& bg);
+		static SIRDS::RowKernel WolframKernel(const SIRDS::BackgroundConfig& bg);
+		static SIRDS::RowKernel Wolfram3Kernel(const SIRDS::BackgroundConfig& bg);
+		static SIRDS::RowKernel VoronoiKernel(const SIRDS::BackgroundConfig& bg);
+		static void BuildStones(SIRDS::DrawSirdsInterface& drawer, int width, int height);
 
 		DrawSIRDSToBitmap();
 		~DrawSIRDSToBitmap() override;
 
 		void Init(SIRDS::BackgroundConfig& bg) override;
-		bool InParallel() override;
+		SIRDS::PatternInput Input() override;
+		int ReadAhead() const override;
+		int BatchWidth() const override;
+		int Cost() const override;
 		void InitBackground(int width, int height) override;
 		void InitPicture(int width, int height, std::function<void(int)> progress) override;
-		void SirdsPicAlgo1(int y, std::vector<SIRDS::Llist> &same);
-		void SirdsPicAlgo2(int y, std::vector<SIRDS::Llist> &same);
-		void SirdsPicWolfram(int y, std::vector<SIRDS::Llist> &same);
-		void SirdsPicWolfram3(int y, std::vector<SIRDS::Llist> &same);
-		void SirdsPicVoronoi(int y, std::vector<SIRDS::Llist> &same);
-		void SirdsPicAlgo(int y, std::vector<SIRDS::Llist> &same) override;
+		void TargetPicture() override;
+		void SirdsPicVoronoi(int y, SIRDS::RowScratch &row, int begin, int end);
+		void SirdsPicAlgo(int y, SIRDS::RowScratch &row, int begin, int end) override;
 		std::shared_ptr<DirectX::Image> Complete() override;
 	};
 
-
-	class DrawSIRDSToColorBitmap : public SIRDS::DrawSirdsInterface
-	{
-		DirectX::ScratchImage & m_backgroundImage;
-		DirectX::ScratchImage m_scaledBackgroundImage;
-		std::shared_ptr<DirectX::Image> m_picture;
-		UINT m_BackgroundWidth;
-		UINT m_BackgroundHeight;
-		BYTE* pv{ nullptr };
-	public:
-		DrawSIRDSToColorBitmap(SIRDS::Background& bg);
-		~DrawSIRDSToColorBitmap() override;
-		void Init(SIRDS::BackgroundConfig& bg) override;
-		bool InParallel() override;
-		void InitBackground(int width, int height) override;
-		void InitPicture(int width, int height, std::function<void(int)> progress) override;
-		void SirdsPicAlgo(int y, std::vector<SIRDS::Llist> &same) override;
-		std::shared_ptr<DirectX::Image> Complete();
-	};
-
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+// DrawSirdsToColor.cpp
+// Draws SIRDS over a bitmap background
+
+#include "DrawSirdsToColor.h"
+#include "SirdsPicture.h"
+
+using namespace std;
+using namespace SIRDS;
+
+DrawSIRDSToColorBitmap::DrawSIRDSToColorBitmap(SIRDS::Background& bg) :
+	m_backgroundImage(bg.backgroundImage_),
+	m_scaledBackgroundImage()
+{
+	//m_backgroundImage = bg.backgroundImage_;
+}
+
+DrawSIRDSToColorBitmap::~DrawSIRDSToColorBitmap()
+{
+}
+
+void DrawSIRDSToColorBitmap::Init(SIRDS::BackgroundConfig& bg)
+{
+
+}
+
+PatternInput DrawSIRDSToColorBitmap::Input()
+{
+	return PatternInput::None;
+}
+
+DXGI_FORMAT DrawSIRDSToColorBitmap::Format() const
+{
+	return m_scaledBackgroundImage.GetMetadata().format;
+}
+
+void DrawSIRDSToColorBitmap::InitBackground(int width, int height)
+{
+	m_BackgroundWidth = width;
+	m_BackgroundHeight = height;
+
+	m_Width = width;
+	m_Height = height;
+
+	DirectX::Resize(m_backgroundImage.GetImages(), 1, m_backgroundImage.GetMetadata(), width, height, 
+		DirectX::TEX_FILTER_FORCE_WIC, m_scaledBackgroundImage);
+	Invalidate();
+}
+
+void DrawSIRDSToColorBitmap::InitPicture(int width, int height, std::function<void(int)> progress)
+{
+	m_Width = width;
+	m_Height = height;
+	m_Progress = progress;
+	// Leased by TargetPicture when a frame is drawn without a sink.
+	m_picture.reset();
+	SetTarget(PixelView());
+
+	pv = m_scaledBackgroundImage.GetPixels();
+	if (pv == nullptr)
+		throw PictureNotFound("No background defined");
+}
+
+void DrawSIRDSToColorBitmap::TargetPicture()
+{
+	if (m_picture == nullptr)
+		m_picture = LeasePicture(m_Width, m_Height, Format());
+	SetTarget(PixelView(reinterpret_cast<uint32_t*>(m_picture->pixels), m_Width, m_Height, m_picture->rowPitch));
+}
+
+void DrawSIRDSToColorBitmap::SirdsPicAlgo(int y, SIRDS::RowScratch &row, int begin, int end)
+{
+	auto paback = reinterpret_cast<int32_t*>(pv);
+	auto pa = reinterpret_cast<int32_t*>(m_Target.Row(y));
+	auto pBackGround = &paback[(y % m_BackgroundHeight) * m_BackgroundWidth];
+
+	const auto& same = row.same;
+	for (int x = begin; x < end; x++) {
+		if (same[x] != x)
+			x = CopyLinkedRun(pa, same.data(), x, end) - 1;
+		else
+			pa[x] = pBackGround[x % m_BackgroundWidth];
+	}
+}
+
+std::shared_ptr<DirectX::Image> DrawSIRDSToColorBitmap::Complete()
+{
+	return TargetImage(m_picture, m_Target, Format());
+}
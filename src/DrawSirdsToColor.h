@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Background.h"
+#include "DrawSirds.h"
+
+namespace SIRDS {
+	struct PictureNotFound : public std::exception {
+		using std::exception::exception;
+	};
+
+	// Fills the picture from a bitmap scaled to the window, so the pattern is
+	// a picture instead of random dots. Needs DirectXTex for the scaling.
+	class DrawSIRDSToColorBitmap : public SIRDS::DrawSirdsInterface
+	{
+		DirectX::ScratchImage & m_backgroundImage;
+		DirectX::ScratchImage m_scaledBackgroundImage;
+		std::shared_ptr<DirectX::Image> m_picture;
+		UINT m_BackgroundWidth;
+		UINT m_BackgroundHeight;
+		BYTE* pv{ nullptr };
+	public:
+		DrawSIRDSToColorBitmap(SIRDS::Background& bg);
+		~DrawSIRDSToColorBitmap() override;
+		void Init(SIRDS::BackgroundConfig& bg) override;
+		SIRDS::PatternInput Input() override;
+		DXGI_FORMAT Format() const override;
+		void InitBackground(int width, int height) override;
+		void InitPicture(int width, int height, std::function<void(int)> progress) override;
+		void TargetPicture() override;
+		void SirdsPicAlgo(int y, SIRDS::RowScratch &row, int begin, int end) override;
+		std::shared_ptr<DirectX::Image> Complete();
+	};
+
+}
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "SirdsDrawer.h"  
 #include "Background.h"
 #include "DrawSirdsTo.h"
+#include "DrawSirdsToColor.h"
 #include <algorithm>
 #include <chrono>
 #include <fstream>
@@ -33,6 +34,14 @@ static inline uint64_t NowMs()
     );
 }
 
+// Strided view of a captured depth texture, read in place.
+template <class T>
+static SIRDS::ImageView<const T> DepthView(const ScratchImage& image)
+{
+    const Image* img = image.GetImage(0, 0, 0);
+    return { reinterpret_cast<const T*>(img->pixels), (int)img->width, (int)img->height, img->rowPitch };
+}
+
 Game* Game::s_instance = nullptr;
 
 Game::Game()
@@ -88,6 +97,7 @@ int Game::Run()
 
 void Game::Cleanup()
 {
+    FlushStereogram();
     if (m_audEngine) m_audEngine->Suspend();
     m_GooseSoundEffect = nullptr;
     m_BuzzSoundEffect = nullptr;
@@ -252,7 +262,7 @@ HRESULT Game::InitDevice()
     descDepth.Height = height;
     descDepth.MipLevels = 1;
     descDepth.ArraySize = 1;
-    descDepth.Format = DXGI_FORMAT_R32_TYPELESS;
+    descDepth.Format = kDepth16 ? DXGI_FORMAT_R16_TYPELESS : DXGI_FORMAT_R32_TYPELESS;
     descDepth.SampleDesc.Count = 1;
     descDepth.SampleDesc.Quality = 0;
     descDepth.Usage = D3D11_USAGE_DEFAULT;
@@ -270,7 +280,7 @@ HRESULT Game::InitDevice()
     // Create the depth stencil view
     D3D11_DEPTH_STENCIL_VIEW_DESC descDSV;
     ZeroMemory(&descDSV, sizeof(descDSV));
-    descDSV.Format = DXGI_FORMAT_D32_FLOAT;
+    descDSV.Format = kDepth16 ? DXGI_FORMAT_D16_UNORM : DXGI_FORMAT_D32_FLOAT;
     descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
     descDSV.Texture2D.MipSlice = 0;
     hr = m_pd3dDevice->CreateDepthStencilView(m_pDepthStencil.Get(), &descDSV, m_pDepthStencilView.GetAddressOf());
@@ -282,7 +292,7 @@ HRESULT Game::InitDevice()
         return hr;
 
     D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-    srDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srDesc.Format = kDepth16 ? DXGI_FORMAT_R16_UNORM : DXGI_FORMAT_R32_FLOAT;
     srDesc.ViewDimension = D3D10_SRV_DIMENSION_TEXTURE2D;
     srDesc.Texture2D.MostDetailedMip = 0;
     srDesc.Texture2D.MipLevels = 1;
@@ -342,6 +352,8 @@ HRESULT Game::InitDevice()
     ID2D1Factory* m_pDirect2dFactory;
     D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &m_pDirect2dFactory);
 
+    m_frameSink.Init(m_pd3dDevice.Get(), m_pImmediateContext.Get());
+    m_frameSink.SetDeferred(kPipelined);
     m_drawer = std::make_unique<SIRDS::DrawSIRDSToBitmap>();
 	m_drawer->Init(m_Backbitmap.config_);
     m_drawer->InitBackground(width, height);
@@ -368,70 +380,15 @@ HRESULT Game::InitDevice()
 
 void Game::LoadStoredBackgrounds()
 {
-    // Example behavior: ensure at least the current background is stored.
+    // Every preset the pattern registry offers, in method order.
     // Replace this with loading backgrounds from disk/resources as needed.
     if (m_storedBackgrounds.empty())
     {
-        SIRDS::BackgroundConfig config;
-        config.density_ = 64;
-        config.density2_ = 128;
-        config.wolframNumber_ = 1236;
-        config.method_ = 1;
-        config.pixelSize_ = 1;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);
-
-        config.density_ = 64;
-		config.density2_ = 164;
-		config.wolframNumber_ = 1236;
-        config.method_ = 1;
-        config.pixelSize_ = 2;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);
-
-        config.density_ = 64;
-        config.density2_ = 164;
-        config.wolframNumber_ = 90;
-        config.method_ = 3;
-        config.pixelSize_ = 2;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);
-
-        config.density_ = 64;
-        config.density2_ = 164;
-        config.wolframNumber_ = 1236;
-        config.method_ = 4;
-        config.pixelSize_ = 2;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);
-
-        config.density_ = 64;
-        config.density2_ = 164;
-        config.wolframNumber_ = 1236;
-        config.method_ = 5;
-        config.pixelSize_ = 2;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);
-        /*
-        config.density_ = 64;
-        config.density2_ = 164;
-        config.wolframNumber_ = 1236;
-        config.method_ = 2;
-        config.pixelSize_ = 2;
-        config.color1_ = 0xFF010101;
-        config.color2_ = 0xFF00FF00;
-        config.color3_ = 0xFF7700FF;
-        m_storedBackgrounds.emplace_back(config);*/
+        for (const SIRDS::PatternInfo& pattern : SIRDS::Patterns())
+        {
+            for (const SIRDS::BackgroundConfig& preset : pattern.presets)
+                m_storedBackgrounds.emplace_back(preset);
+        }
     }
 }
 
@@ -447,6 +404,8 @@ void Game::ChangeBackground(size_t index)
 
     // Copy stored background into the active background used by the drawer.
     // Background copies non-image members and the ScratchImage if it supports copy/move.
+    // The converter thread may still be drawing with the old background.
+    FlushStereogram();
     m_Backbitmap.config_ = m_storedBackgrounds[index];
     // Re-initialize the drawer so it picks up the new background pixels.
     if (m_drawer)
@@ -583,6 +542,14 @@ LRESULT Game::HandleMessage(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
             DebugOut() << "Debug pre-sirds: " << m_debugShowPreSirds;
             break;
         }
+        // F2 toggles stable dots: the pattern no longer re-rolls every frame
+        if (wParam == VK_F2)
+        {
+            FlushStereogram();
+            m_sirdsDrawer.bStableDots_ = !m_sirdsDrawer.bStableDots_;
+            DebugOut() << "Stable dots: " << m_sirdsDrawer.bStableDots_;
+            break;
+        }
 
         if (flappyData.mode != GameMode::Play) {
             float tKeyPress = GetElapsedTime();
@@ -916,18 +883,12 @@ void Game::RenderToTarget(ID3D11RenderTargetView* RenderTargetView, ID3D11DepthS
     pZResource->GetDesc(&desc);
     ID3D11Resource* pResource;
     pZResource->GetResource(&pResource);
-    ScratchImage newImage;
-    CaptureTexture(m_pd3dDevice.Get(), m_pImmediateContext.Get(), pResource, newImage);
+    // The capture is kept and handed to the stereogram as a strided view, so
+    // the depth is never copied out of it.
+    ScratchImage& zImage = (flappyData.eye == EyeUsed::LeftEye) ? g_leftZImage : g_rightZImage;
+    CaptureTexture(m_pd3dDevice.Get(), m_pImmediateContext.Get(), pResource, zImage);
     timer3 = NowMs();
-    auto Images = newImage.GetImages();
-    auto bufferSize = Images->width * Images->height;
-    auto source = (float*)Images->pixels;
-
-    vector<float>& zBuffer = ((flappyData.eye == EyeUsed::LeftEye) ? g_leftZBuffer : g_rightZBuffer);
-    if (zBuffer.size() != bufferSize)
-        zBuffer.resize(bufferSize);
     timer4 = NowMs();
-    std::copy(source, source + bufferSize, zBuffer.begin());
     timer5 = NowMs();
 }
 
@@ -988,7 +949,7 @@ void Game::Render()
     flappyData.eye = EyeUsed::RightEye;
     RenderToTarget(m_pRenderTargetView.Get(), m_pDepthStencilView.Get(), m_pZResource.Get(), t, false);
     timer3 = NowMs();
-    if (g_rightZBuffer.empty() || g_leftZBuffer.empty())
+    if (g_rightZImage.GetImageCount() == 0 || g_leftZImage.GetImageCount() == 0)
         return;
     
     // If debug mode is on, show the last rendered backbuffer (pre-stereogram)
@@ -1020,33 +981,53 @@ void Game::Render()
     }
     UINT dpi = GetDpiForWindow(m_hWnd); // m_hwnd is your window handle
     auto dpiX = static_cast<float>(dpi);
-    m_sirdsDrawer.fPMM_ = dpiX / 25.4f;
+    if (const float pmm = dpiX / 25.4f; pmm != m_sirdsDrawer.fPMM_)
+    {
+        FlushStereogram();
+        m_sirdsDrawer.fPMM_ = pmm;
+    }
     //InitStatics(flappyData.view, (int)width, (int)height);
 	SIRDS::DrawSirdsInterface* drawer = m_Backbitmap.config_.method_ == 2 ? m_drawer2.get() : m_drawer.get();
-    m_sirdsDrawer.ZBuffersToDrawer(g_leftZBuffer, g_rightZBuffer, (int)width, (int)height, 
-        drawer);
-    timer4 = NowMs();
-    ScratchImage sImage;
-    shared_ptr<DirectX::Image> img = m_drawer->Complete();
-    /*Image img;
-    img.width = width;
-    img.height = height;
-    img.format = DXGI_FORMAT_B8G8R8A8_UNORM;
-    img.rowPitch = width * sizeof(UINT);
-    img.slicePitch = img.rowPitch * img.height;
-    img.pixels = (uint8_t*)&pixels[0];*/
-    sImage.InitializeFromImage(*img);
-    if (m_SirdsShader)
-        m_SirdsShader.Reset();
+    m_frameSink.SetFormat(drawer->Format());
+    if constexpr (kPipelined)
+    {
+        // Hand this frame's depth to the converter thread and show the frame
+        // it finished meanwhile; the next depth is rendered while this one
+        // is being converted.
+        auto depth = std::make_shared<std::pair<ScratchImage, ScratchImage>>(std::move(g_leftZImage), std::move(g_rightZImage));
+        SIRDS::DepthFrame frame;
+        if constexpr (kDepth16)
+        {
+            frame.left16 = DepthView<uint16_t>(depth->first);
+            frame.right16 = DepthView<uint16_t>(depth->second);
+        }
+        else
+        {
+            frame.left = DepthView<float>(depth->first);
+            frame.right = DepthView<float>(depth->second);
+        }
+        frame.keepAlive = depth;
+        frame.drawer = drawer;
+        frame.sink = &m_frameSink;
+        m_pipeline.Submit(std::move(frame));
+        timer4 = NowMs();
+        m_frameSink.Upload();
+    }
+    else
+    {
+        if constexpr (kDepth16)
+            m_sirdsDrawer.ZBuffersToDrawer(DepthView<uint16_t>(g_leftZImage), DepthView<uint16_t>(g_rightZImage), drawer, &m_frameSink);
+        else
+            m_sirdsDrawer.ZBuffersToDrawer(DepthView<float>(g_leftZImage), DepthView<float>(g_rightZImage), drawer, &m_frameSink);
+        timer4 = NowMs();
+    }
     timer5 = NowMs();
-    if (auto hr = DirectX::CreateShaderResourceView(m_pd3dDevice.Get(),
-        sImage.GetImage(0, 0, 0), 1, sImage.GetMetadata(), m_SirdsShader.GetAddressOf());
-        hr != S_OK)
+    if (m_frameSink.View() == nullptr)
         return;
     timer6 = NowMs();
     m_pImmediateContext->ClearRenderTargetView(m_pRenderTargetView.Get(), Colors::Black);
     m_Sprites->Begin(SpriteSortMode_Deferred);
-    m_Sprites->Draw(m_SirdsShader.Get(), XMFLOAT2(0, 0), nullptr, Colors::White);
+    m_Sprites->Draw(m_frameSink.View(), XMFLOAT2(0, 0), nullptr, Colors::White);
     m_Sprites->End();
     timer7 = NowMs();
     m_pSwapChain->Present(0, 0);
@@ -1060,6 +1041,13 @@ void Game::Render()
         << ",FPS " << 1000.f / (float)(timer7 - timer1);
 }
 
+void Game::FlushStereogram()
+{
+    // The converter may be waiting for its last frame to be uploaded, which
+    // only this thread can do.
+    m_pipeline.Flush([this] { m_frameSink.Upload(); });
+}
+
 void Game::DoAudio()
 {
     if (!m_audEngine->Update())
@@ -1154,7 +1142,7 @@ void Game::OnResize(UINT width, UINT height)
     descDepth.Height = height;
     descDepth.MipLevels = 1;
     descDepth.ArraySize = 1;
-    descDepth.Format = DXGI_FORMAT_R32_TYPELESS;
+    descDepth.Format = kDepth16 ? DXGI_FORMAT_R16_TYPELESS : DXGI_FORMAT_R32_TYPELESS;
     descDepth.SampleDesc.Count = 1;
     descDepth.SampleDesc.Quality = 0;
     descDepth.Usage = D3D11_USAGE_DEFAULT;
@@ -1177,7 +1165,7 @@ void Game::OnResize(UINT width, UINT height)
 
     D3D11_DEPTH_STENCIL_VIEW_DESC descDSV;
     ZeroMemory(&descDSV, sizeof(descDSV));
-    descDSV.Format = DXGI_FORMAT_D32_FLOAT;
+    descDSV.Format = kDepth16 ? DXGI_FORMAT_D16_UNORM : DXGI_FORMAT_D32_FLOAT;
     descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
     descDSV.Texture2D.MipSlice = 0;
 
@@ -1196,7 +1184,7 @@ void Game::OnResize(UINT width, UINT height)
 
     // Recreate SRVs for depth textures (used for depth capture)
     D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-    srDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srDesc.Format = kDepth16 ? DXGI_FORMAT_R16_UNORM : DXGI_FORMAT_R32_FLOAT;
     srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
     srDesc.Texture2D.MostDetailedMip = 0;
     srDesc.Texture2D.MipLevels = 1;
@@ -1233,5 +1221,21 @@ void Game::OnResize(UINT width, UINT height)
     vp.TopLeftX = 0;
     vp.TopLeftY = 0;
     m_pImmediateContext->RSSetViewports(1, &vp);
+
+    // The drawers' backgrounds were rendered for the old size.
+    if ((width != m_clientWidth || height != m_clientHeight) && width > 0 && height > 0)
+    {
+        FlushStereogram();
+        for (SIRDS::DrawSirdsInterface* drawer : { m_drawer.get(), m_drawer2.get() })
+        {
+            if (drawer == nullptr)
+                continue;
+            drawer->InitBackground(width, height);
+            drawer->InitPicture(width, height,
+                [](int ) { /* no progress callback here */ });
+        }
+    }
+    m_clientWidth = width;
+    m_clientHeight = height;
     DebugOut() << "Resized to " << width << "x" << height;
 }
\ No newline at end of file
@@ -25,6 +25,8 @@
 #include "SpiralIntro.h"
 #include "DrawSirds.h"
 #include "Background.h"
+#include "TextureSink.h"
+#include "SirdsPipeline.h"
 
 #include <memory>
 #include <vector>
@@ -90,6 +92,7 @@ private:
     void LoadStoredBackgrounds();                    // populate stored list (stub / load from resources)
     void AddStoredBackground(const SIRDS::BackgroundConfig& bg);
     void ChangeBackground(size_t index);                // copy stored background -> active background
+    void FlushStereogram();                             // wait for frames still being converted
 
 private:
     // Window / device
@@ -137,8 +140,12 @@ private:
     // extracted gameplay state moved to its own type and header
     FlappyData flappyData;
 
-    std::vector<float> g_leftZBuffer;
-    std::vector<float> g_rightZBuffer;
+    // Render into a 16 bit UNORM depth buffer and hand the stereogram integer
+    // depth: half the readback and no float math in the row setup.
+    static constexpr bool kDepth16 = false;
+    // Last depth capture of each eye, float or 16 bit per kDepth16.
+    DirectX::ScratchImage g_leftZImage;
+    DirectX::ScratchImage g_rightZImage;
     std::unique_ptr<DirectX::AudioEngine> m_audEngine;
     std::unique_ptr<DirectX::SoundEffect> m_GooseSoundEffect;
     std::unique_ptr<DirectX::SoundEffect> m_HeronSoundEffect;
@@ -154,6 +161,11 @@ private:
     SIRDS::SIRDSDrawer m_sirdsDrawer;
     std::unique_ptr <SIRDS::DrawSirdsInterface> m_drawer;
     std::unique_ptr <SIRDS::DrawSirdsInterface> m_drawer2;
+    // Stereogram rows are drawn straight into this sink's upload buffer.
+    TextureSink m_frameSink;
+    // Converts frame N on its own thread while frame N + 1's depth is rendered.
+    static constexpr bool kPipelined = true;
+    SIRDS::FramePipeline m_pipeline{ m_sirdsDrawer };
     SIRDS::Background m_Backbitmap;
     // Stored backgrounds list (user-switchable)
     std::vector<SIRDS::BackgroundConfig> m_storedBackgrounds;
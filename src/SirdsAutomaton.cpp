@@ -0,0 +1,72 @@
+// SirdsAutomaton.cpp
+// Bit-sliced elementary cellular automaton for the Wolfram backgrounds
+
+#include "SirdsAutomaton.h"
+#include "SirdsSimd.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace SIRDS::Automaton
+{
+	namespace {
+		// 64 cells starting at cell i, which need not be word aligned.
+		inline uint64_t CellsAt(const uint64_t* cells, int i)
+		{
+			const int w = i >> 6;
+			const int shift = i & 63;
+			if (shift == 0)
+				return cells[w];
+			return (cells[w] >> shift) | (cells[w + 1] << (64 - shift));
+		}
+	}
+
+	void Pack(const uint32_t* row, uint32_t zero, int first, int last, int count, uint64_t* cells)
+	{
+		const int words = Words(count);
+		for (int w = 0; w < words; w++) {
+			const int p0 = first + w * kCellsPerWord;
+			uint64_t word = 0;
+			int i = 0;
+			if (p0 >= 0 && p0 + kCellsPerWord - 1 <= last) {
+#if defined(SIRDS_AVX2)
+				const __m256i z = _mm256_set1_epi32(static_cast<int>(zero));
+				for (; i < kCellsPerWord; i += 8) {
+					const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + p0 + i));
+					const unsigned eq = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, z))));
+					word |= static_cast<uint64_t>(~eq & 0xFFu) << i;
+				}
+#elif defined(SIRDS_SSE2)
+				const __m128i z = _mm_set1_epi32(static_cast<int>(zero));
+				for (; i < kCellsPerWord; i += 4) {
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + p0 + i));
+					const unsigned eq = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, z))));
+					word |= static_cast<uint64_t>(~eq & 0xFu) << i;
+				}
+#endif
+			}
+			for (; i < kCellsPerWord; i++) {
+				const int p = min(max(p0 + i, 0), last);
+				word |= static_cast<uint64_t>(row[p] != zero) << i;
+			}
+			cells[w] = word;
+		}
+	}
+
+	void Step(const uint64_t* cells, int span, int rule, int words, uint64_t* next)
+	{
+		for (int w = 0; w < words; w++) {
+			const int i = w * kCellsPerWord;
+			const uint64_t l = CellsAt(cells, i);
+			const uint64_t c = CellsAt(cells, i + span);
+			const uint64_t r = CellsAt(cells, i + 2 * span);
+			// One minterm per neighbourhood the rule maps to 1.
+			uint64_t out = 0;
+			for (int v = 0; v < 8; v++) {
+				if ((rule >> v) & 1)
+					out |= ((v & 1) ? l : ~l) & ((v & 2) ? c : ~c) & ((v & 4) ? r : ~r);
+			}
+			next[w] = out;
+		}
+	}
+}
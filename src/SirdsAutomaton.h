@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+namespace SIRDS {
+
+	// Elementary cellular automaton on bit-packed rows, 64 cells per word.
+	// Cell i of a packed row is bit (i & 63) of word (i >> 6).
+	namespace Automaton {
+		constexpr int kCellsPerWord = 64;
+
+		inline int Words(int cells) { return (cells + kCellsPerWord - 1) / kCellsPerWord; }
+
+		// Packs count cells, cell i being 1 when row[first + i] != zero. Pixels
+		// outside [0, last] read as row[0] or row[last]. Whole words inside the
+		// row are compared with AVX2 or SSE2.
+		void Pack(const uint32_t* row, uint32_t zero, int first, int last, int count, uint64_t* cells);
+
+		// Next generation of words * 64 cells: cell i becomes bit v of rule,
+		// v = left + 2 * centre + 4 * right, reading cells i, i + span and
+		// i + 2 * span. cells must hold words * 64 + 2 * span packed cells.
+		void Step(const uint64_t* cells, int span, int rule, int words, uint64_t* next);
+	}
+}
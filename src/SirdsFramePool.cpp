@@ -0,0 +1,226 @@
+// SirdsFramePool.cpp
+// Pooled, aligned frame buffers for the SIRDS drawers
+
+#include "SirdsFramePool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+namespace SIRDS
+{
+	struct FrameLease::Buffer {
+		int width = 0;
+		int height = 0;
+		int format = 0;
+		int bytesPerPixel = 0;
+		size_t rowPitch = 0;
+		size_t size = 0;
+		uint8_t* data = nullptr;
+		bool largePages = false;  // allocated with VirtualAlloc(MEM_LARGE_PAGES)
+		bool leased = false;
+		uint64_t returned = 0;  // FramePool::clock_ when last released
+
+		bool Matches(int w, int h, int f, int bpp) const
+		{
+			return width == w && height == h && format == f && bytesPerPixel == bpp;
+		}
+	};
+
+	namespace {
+		constexpr size_t kHugePage = 2u << 20;
+
+		size_t RoundUp(size_t n, size_t to)
+		{
+			return (n + to - 1) / to * to;
+		}
+
+		uint8_t* Allocate(size_t bytes, bool hugePages, bool& largePages)
+		{
+			largePages = false;
+#if defined(_WIN32)
+			// Large pages need SeLockMemoryPrivilege; without it this fails and
+			// the buffer falls back to ordinary pages.
+			if (hugePages) {
+				if (const size_t page = GetLargePageMinimum(); page != 0) {
+					void* p = VirtualAlloc(nullptr, RoundUp(bytes, page), MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+					if (p != nullptr) {
+						largePages = true;
+						return static_cast<uint8_t*>(p);
+					}
+				}
+			}
+			return static_cast<uint8_t*>(_aligned_malloc(bytes, FramePool::kRowAlignment));
+#else
+			if (hugePages && bytes >= kHugePage) {
+				const size_t rounded = RoundUp(bytes, kHugePage);
+				if (void* p = aligned_alloc(kHugePage, rounded); p != nullptr) {
+					madvise(p, rounded, MADV_HUGEPAGE);
+					return static_cast<uint8_t*>(p);
+				}
+			}
+			return static_cast<uint8_t*>(aligned_alloc(FramePool::kRowAlignment, RoundUp(bytes, FramePool::kRowAlignment)));
+#endif
+		}
+
+		void Deallocate(uint8_t* p, bool largePages)
+		{
+#if defined(_WIN32)
+			if (largePages)
+				VirtualFree(p, 0, MEM_RELEASE);
+			else
+				_aligned_free(p);
+#else
+			(void)largePages;
+			free(p);
+#endif
+		}
+	}
+
+	FrameLease::FrameLease(FrameLease&& o) noexcept : pool_(o.pool_), buffer_(o.buffer_)
+	{
+		o.pool_ = nullptr;
+		o.buffer_ = nullptr;
+	}
+
+	FrameLease& FrameLease::operator=(FrameLease&& o) noexcept
+	{
+		if (this != &o) {
+			Reset();
+			pool_ = o.pool_;
+			buffer_ = o.buffer_;
+			o.pool_ = nullptr;
+			o.buffer_ = nullptr;
+		}
+		return *this;
+	}
+
+	void FrameLease::Reset()
+	{
+		if (buffer_ != nullptr)
+			pool_->Release(buffer_);
+		pool_ = nullptr;
+		buffer_ = nullptr;
+	}
+
+	uint8_t* FrameLease::Data() const { return buffer_ ? buffer_->data : nullptr; }
+	size_t FrameLease::RowPitch() const { return buffer_ ? buffer_->rowPitch : 0; }
+	size_t FrameLease::Size() const { return buffer_ ? buffer_->size : 0; }
+	int FrameLease::Width() const { return buffer_ ? buffer_->width : 0; }
+	int FrameLease::Height() const { return buffer_ ? buffer_->height : 0; }
+
+	PixelView FrameLease::Pixels() const
+	{
+		if (buffer_ == nullptr)
+			return PixelView();
+		return PixelView(reinterpret_cast<uint32_t*>(buffer_->data), buffer_->width, buffer_->height, buffer_->rowPitch);
+	}
+
+	FramePool::FramePool(int buffersPerKey, bool hugePages, size_t idleBytes) :
+		buffersPerKey_(max(buffersPerKey, 1)), hugePages_(hugePages), idleBytes_(idleBytes)
+	{
+	}
+
+	FramePool::~FramePool()
+	{
+		// Outstanding leases would point into freed memory; only idle buffers
+		// can be released here.
+		Trim();
+	}
+
+	FrameLease FramePool::Acquire(int width, int height, int format, int bytesPerPixel)
+	{
+		lock_guard<mutex> lock(mutex_);
+		for (auto& b : buffers_) {
+			if (!b->leased && b->Matches(width, height, format, bytesPerPixel)) {
+				b->leased = true;
+				return FrameLease(this, b.get());
+			}
+		}
+
+		auto b = make_unique<FrameLease::Buffer>();
+		b->width = width;
+		b->height = height;
+		b->format = format;
+		b->bytesPerPixel = bytesPerPixel;
+		b->rowPitch = RoundUp(static_cast<size_t>(width) * bytesPerPixel, kRowAlignment);
+		b->size = b->rowPitch * height;
+		b->data = Allocate(max<size_t>(b->size, 1), hugePages_, b->largePages);
+		if (b->data == nullptr)
+			throw bad_alloc();
+		b->leased = true;
+		buffers_.push_back(move(b));
+		return FrameLease(this, buffers_.back().get());
+	}
+
+	void FramePool::Release(FrameLease::Buffer* buffer)
+	{
+		lock_guard<mutex> lock(mutex_);
+		buffer->leased = false;
+		buffer->returned = ++clock_;
+		const auto idle = count_if(buffers_.begin(), buffers_.end(), [buffer](const auto& b) {
+			return !b->leased && b->Matches(buffer->width, buffer->height, buffer->format, buffer->bytesPerPixel);
+		});
+		if (idle > buffersPerKey_) {
+			auto it = find_if(buffers_.begin(), buffers_.end(), [buffer](const auto& b) { return b.get() == buffer; });
+			Free(*it);
+			buffers_.erase(it);
+		}
+		EvictIdle();
+	}
+
+	// Frees the least recently returned idle buffers until the idle ones fit
+	// in idleBytes_. Called with mutex_ held.
+	void FramePool::EvictIdle()
+	{
+		size_t idle = 0;
+		for (const auto& b : buffers_) {
+			if (!b->leased)
+				idle += b->size;
+		}
+		while (idle > idleBytes_) {
+			auto oldest = buffers_.end();
+			for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+				if (!(*it)->leased && (oldest == buffers_.end() || (*it)->returned < (*oldest)->returned))
+					oldest = it;
+			}
+			idle -= (*oldest)->size;
+			Free(*oldest);
+			buffers_.erase(oldest);
+		}
+	}
+
+	void FramePool::Trim()
+	{
+		lock_guard<mutex> lock(mutex_);
+		for (auto& b : buffers_) {
+			if (!b->leased)
+				Free(b);
+		}
+		buffers_.erase(remove(buffers_.begin(), buffers_.end(), nullptr), buffers_.end());
+	}
+
+	// Returns the memory and empties the entry; the caller erases it.
+	void FramePool::Free(std::unique_ptr<FrameLease::Buffer>& entry)
+	{
+		Deallocate(entry->data, entry->largePages);
+		entry.reset();
+	}
+
+	FramePool& FramePool::Shared()
+	{
+		// Frames are large and rewritten every frame, so huge pages save TLB
+		// misses; the allocation falls back to normal pages where denied.
+		static FramePool* pool = new FramePool(2, true);
+		return *pool;
+	}
+}
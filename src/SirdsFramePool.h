@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SirdsView.h"
+
+namespace SIRDS {
+
+	class FramePool;
+
+	// A frame buffer on loan from a FramePool. Move-only; the buffer goes back
+	// to the pool when the lease is reset or destroyed.
+	class FrameLease
+	{
+	public:
+		FrameLease() = default;
+		~FrameLease() { Reset(); }
+		FrameLease(FrameLease&& o) noexcept;
+		FrameLease& operator=(FrameLease&& o) noexcept;
+		FrameLease(const FrameLease&) = delete;
+		FrameLease& operator=(const FrameLease&) = delete;
+
+		void Reset();
+		explicit operator bool() const { return buffer_ != nullptr; }
+
+		uint8_t* Data() const;
+		size_t RowPitch() const;
+		size_t Size() const;
+		int Width() const;
+		int Height() const;
+
+		// The buffer as 32 bit pixels.
+		PixelView Pixels() const;
+
+	private:
+		friend class FramePool;
+		struct Buffer;
+		FrameLease(FramePool* pool, Buffer* buffer) : pool_(pool), buffer_(buffer) {}
+
+		FramePool* pool_ = nullptr;
+		Buffer* buffer_ = nullptr;
+	};
+
+	// Frame buffers keyed by (width, height, format). Returned buffers stay in
+	// the pool, up to buffersPerKey idle ones per key, so redrawing at the same
+	// size - a background switch, the next frame - reuses memory that is
+	// already mapped. Once the idle buffers pass idleBytes the least recently
+	// returned ones are freed, so a resize back and forth keeps both sizes
+	// while the old sizes of a long session age out.
+	class FramePool
+	{
+	public:
+		// Rows start on this boundary, so every row is SIMD aligned.
+		static constexpr size_t kRowAlignment = 64;
+		static constexpr size_t kIdleBytes = size_t(256) << 20;
+
+		explicit FramePool(int buffersPerKey = 2, bool hugePages = false, size_t idleBytes = kIdleBytes);
+		~FramePool();
+
+		FramePool(const FramePool&) = delete;
+		FramePool& operator=(const FramePool&) = delete;
+
+		// format is opaque to the pool; it only tells buffers apart.
+		FrameLease Acquire(int width, int height, int format, int bytesPerPixel = 4);
+
+		// Frees every idle buffer.
+		void Trim();
+
+		// Pool shared by the drawers. Never destroyed, so leases may outlive
+		// any static that uses them.
+		static FramePool& Shared();
+
+	private:
+		friend class FrameLease;
+		void Release(FrameLease::Buffer* buffer);
+		void Free(std::unique_ptr<FrameLease::Buffer>& entry);
+		void EvictIdle();
+
+		int buffersPerKey_;
+		bool hugePages_;
+		size_t idleBytes_;
+		uint64_t clock_ = 0;  // stamps buffers as they are returned
+		std::mutex mutex_;
+		std::vector<std::unique_ptr<FrameLease::Buffer>> buffers_;
+	};
+}
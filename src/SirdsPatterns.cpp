@@ -0,0 +1,96 @@
+// SirdsPatterns.cpp
+// Registry of the background patterns DrawSIRDSToBitmap can draw
+
+#include "SirdsPatterns.h"
+#include <algorithm>
+#include "DrawSirdsTo.h"
+#include "SirdsAutomaton.h"
+
+using namespace std;
+
+namespace SIRDS
+{
+	namespace {
+		BackgroundConfig Preset(int method, int pixelSize, int density2, int wolframNumber)
+		{
+			BackgroundConfig bg;
+			bg.density_ = 64;
+			bg.density2_ = density2;
+			bg.wolframNumber_ = wolframNumber;
+			bg.method_ = method;
+			bg.pixelSize_ = pixelSize;
+			bg.color1_ = 0xFF010101;
+			bg.color2_ = 0xFF00FF00;
+			bg.color3_ = 0xFF7700FF;
+			return bg;
+		}
+
+		// Pixel blocks taller than one row repeat the row above.
+		PatternInput DotsInput(const BackgroundConfig& bg)
+		{
+			return bg.pixelSize_ <= 1 && bg.density2_ == 0 ? PatternInput::None : PatternInput::PreviousRow;
+		}
+
+		PatternInput Dots2Input(const BackgroundConfig& bg)
+		{
+			return bg.pixelSize_ <= 1 ? PatternInput::None : PatternInput::PreviousRow;
+		}
+
+		PatternInput AutomatonInput(const BackgroundConfig&)
+		{
+			return PatternInput::PreviousRow;
+		}
+
+		PatternInput PositionInput(const BackgroundConfig&)
+		{
+			return PatternInput::None;
+		}
+
+		// The packed Wolfram row reads the block to the right of end and up
+		// to 63 more cells to fill its last word.
+		int WolframReadAhead(const BackgroundConfig& bg)
+		{
+			return std::max(bg.pixelSize_, 1) + Automaton::kCellsPerWord;
+		}
+
+		int BlockReadAhead(const BackgroundConfig& bg)
+		{
+			return std::max(bg.pixelSize_, 1);
+		}
+	}
+
+	const vector<PatternInfo>& Patterns()
+	{
+		static const vector<PatternInfo> patterns = {
+			{ 1, "dots", DotsInput, nullptr, DrawSIRDSToBitmap::DotsKernel, nullptr, true, 1, 1,
+				{ Preset(1, 1, 128, 1236), Preset(1, 2, 164, 1236) } },
+			// Method 2 backgrounds in the game come from a bitmap instead.
+			{ 2, "dots2", Dots2Input, nullptr, DrawSIRDSToBitmap::Dots2Kernel, nullptr, true, 1, 1, {} },
+			{ 3, "wolfram", AutomatonInput, WolframReadAhead, DrawSIRDSToBitmap::WolframKernel, nullptr, true, 64, 1,
+				{ Preset(3, 2, 164, 90) } },
+			{ 4, "wolfram3", AutomatonInput, BlockReadAhead, DrawSIRDSToBitmap::Wolfram3Kernel, nullptr, true, 1, 2,
+				{ Preset(4, 2, 164, 1236) } },
+			{ 5, "voronoi", PositionInput, nullptr, DrawSIRDSToBitmap::VoronoiKernel, DrawSIRDSToBitmap::BuildStones,
+				false, 8, 20, { Preset(5, 2, 164, 1236) } },
+		};
+		return patterns;
+	}
+
+	const PatternInfo* FindPattern(int method)
+	{
+		for (const PatternInfo& p : Patterns()) {
+			if (p.method == method)
+				return &p;
+		}
+		return nullptr;
+	}
+
+	const PatternInfo* FindPattern(const string& name)
+	{
+		for (const PatternInfo& p : Patterns()) {
+			if (name == p.name)
+				return &p;
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "SirdsBackgroundConfig.h"
+
+namespace SIRDS {
+
+	// What a pattern's unlinked pixels read besides the config and (x, y).
+	enum class PatternInput {
+		None,           // rows can be drawn in any order
+		PreviousRow,    // the row above as drawn this frame; rows go in order
+	};
+
+	class DrawSirdsInterface;
+	struct RowScratch;
+
+	// Fills columns [begin, end) of row y in the drawer's target. The drawer
+	// is the one whose kernel factory returned it.
+	using RowKernel = void (*)(DrawSirdsInterface& drawer, int y, RowScratch& row, int begin, int end);
+
+	// A background generator as the engine and the game see it. A new
+	// pattern is a row here plus its kernel in DrawSIRDSToBitmap; the engine
+	// picks the row order and the drawer its kernel and caching from what it
+	// declares.
+	struct PatternInfo {
+		int method;        // BackgroundConfig::method_
+		const char* name;
+		// Inputs for this config; pixel size and density2 can add the row above.
+		PatternInput (*input)(const BackgroundConfig& bg);
+		// Columns past end the kernel reads in the row above; nullptr for none.
+		int (*readAhead)(const BackgroundConfig& bg);
+		// The kernel for this config, specialised on pixel size and density2.
+		RowKernel (*kernel)(const BackgroundConfig& bg);
+		// Run by InitBackground before any row of a new size is drawn; nullptr
+		// when the pattern keeps nothing per size.
+		void (*prepare)(DrawSirdsInterface& drawer, int width, int height);
+		bool seeded;       // reads the frame's random seed, so differs per frame
+		int batchWidth;    // unlinked pixels the kernel works on per step
+		int cost;          // rough cost of one unlinked pixel, 1 being a compare
+		std::vector<BackgroundConfig> presets;  // offered by the game, in order
+
+		// Draws the same pixels every frame, so the drawer may render it once
+		// per background and size and fetch from that.
+		bool Cacheable(const BackgroundConfig& bg) const
+		{
+			// Fetching a cached pixel costs about a compare itself.
+			return !seeded && cost > 1 && input(bg) == PatternInput::None;
+		}
+	};
+
+	// Every pattern, ordered by method.
+	const std::vector<PatternInfo>& Patterns();
+
+	// nullptr when no pattern has that method or name.
+	const PatternInfo* FindPattern(int method);
+	const PatternInfo* FindPattern(const std::string& name);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "SirdsPlatform.h"
+#include "SirdsRow.h"
+#include "SirdsView.h"
+
+// Pieces shared by the DrawSirdsInterface implementations.
+namespace SIRDS {
+
+	// A picture leased from FramePool::Shared(). Its pixels hold whatever the
+	// buffer last held; a frame writes every one of them.
+	std::shared_ptr<DirectX::Image> LeasePicture(int width, int height, DXGI_FORMAT format);
+
+	// The drawer's own picture, or an image over the buffer SetTarget gave it.
+	std::shared_ptr<DirectX::Image> TargetImage(const std::shared_ptr<DirectX::Image>& own, const PixelView& target,
+		DXGI_FORMAT format);
+
+	// Runs shorter than this are copied pixel by pixel.
+	constexpr int kMinCopyRun = 8;
+
+	// Copies pa[x] = pa[same[x]] for the run of linked pixels starting at x
+	// that share one link offset, and returns the pixel after the run. Flat
+	// depth gives long runs; a run longer than its offset is moved in
+	// offset-sized chunks so every memcpy reads pixels that are already final.
+	template <class Pixel>
+	inline int CopyLinkedRun(Pixel* pa, const Link* same, int x, int end)
+	{
+		const int d = x - same[x];
+		int runEnd = x + 1;
+		while (runEnd < end && runEnd - same[runEnd] == d)
+			runEnd++;
+
+		if (d <= 0 || runEnd - x < kMinCopyRun) {
+			for (int i = x; i < runEnd; i++)
+				pa[i] = pa[i - d];
+			return runEnd;
+		}
+		for (int i = x; i < runEnd; i += d)
+			memcpy(&pa[i], &pa[i - d], std::min(d, runEnd - i) * sizeof(Pixel));
+		return runEnd;
+	}
+}
@@ -0,0 +1,110 @@
+// SirdsPipeline.cpp
+// Overlaps depth production with stereogram conversion of the previous frame
+
+#include "SirdsPipeline.h"
+#include "DrawSirds.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace SIRDS
+{
+	FramePipeline::FramePipeline(SIRDSDrawer& engine, int capacity) :
+		engine_(engine), capacity_(static_cast<size_t>(max(capacity, 1))), thread_([this] { Run(); })
+	{
+	}
+
+	FramePipeline::~FramePipeline()
+	{
+		{
+			lock_guard<mutex> lock(mutex_);
+			stop_ = true;
+			// Converting them could wait on a sink nobody pumps any more.
+			queue_.clear();
+		}
+		changed_.notify_all();
+		thread_.join();
+	}
+
+	void FramePipeline::Submit(DepthFrame frame)
+	{
+		unique_lock<mutex> lock(mutex_);
+		changed_.wait(lock, [this] { return queue_.size() < capacity_ || error_ != nullptr; });
+		RethrowLocked();
+		queue_.push_back(move(frame));
+		lock.unlock();
+		changed_.notify_all();
+	}
+
+	void FramePipeline::Flush(const function<void()>& pump)
+	{
+		unique_lock<mutex> lock(mutex_);
+		while (!queue_.empty() || busy_) {
+			if (pump) {
+				lock.unlock();
+				pump();
+				lock.lock();
+				changed_.wait_for(lock, chrono::milliseconds(1));
+			}
+			else {
+				changed_.wait(lock);
+			}
+		}
+		RethrowLocked();
+	}
+
+	uint64_t FramePipeline::Converted() const
+	{
+		lock_guard<mutex> lock(mutex_);
+		return converted_;
+	}
+
+	void FramePipeline::RethrowLocked()
+	{
+		if (error_ != nullptr) {
+			exception_ptr error = error_;
+			error_ = nullptr;
+			rethrow_exception(error);
+		}
+	}
+
+	void FramePipeline::Run()
+	{
+		for (;;) {
+			DepthFrame frame;
+			{
+				unique_lock<mutex> lock(mutex_);
+				changed_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+				if (queue_.empty())
+					return;
+				frame = move(queue_.front());
+				queue_.pop_front();
+				busy_ = true;
+			}
+			changed_.notify_all();
+
+			exception_ptr error;
+			try {
+				if (!frame.left.empty())
+					engine_.ZBuffersToDrawer(frame.left, frame.right, frame.drawer, frame.sink);
+				else
+					engine_.ZBuffersToDrawer(frame.left16, frame.right16, frame.drawer, frame.sink);
+			}
+			catch (...) {
+				error = current_exception();
+			}
+			// The depth is released here, on the converter thread.
+			frame = DepthFrame();
+
+			{
+				lock_guard<mutex> lock(mutex_);
+				busy_ = false;
+				converted_++;
+				if (error != nullptr)
+					error_ = error;
+			}
+			changed_.notify_all();
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "SirdsView.h"
+
+namespace SIRDS {
+
+	class SIRDSDrawer;
+	class DrawSirdsInterface;
+
+	// Depth of one frame in flight. The views must stay valid until the frame
+	// has been converted, so keepAlive owns whatever they point into.
+	struct DepthFrame {
+		ImageView<const float> left;
+		ImageView<const float> right;
+		// 16 bit depth, used when left is empty.
+		ImageView<const uint16_t> left16;
+		ImageView<const uint16_t> right16;
+		std::shared_ptr<void> keepAlive;
+		DrawSirdsInterface* drawer = nullptr;
+		FrameSink* sink = nullptr;
+	};
+
+	// Two-stage frame pipeline: the caller produces depth while a converter
+	// thread turns the frame before it into a stereogram. The queue between
+	// the stages is bounded, so the producer runs at most capacity frames ahead
+	// and then blocks instead of piling up depth.
+	class FramePipeline
+	{
+	public:
+		explicit FramePipeline(SIRDSDrawer& engine, int capacity = 1);
+		// Drops the frames still queued and waits for the one being converted.
+		// That frame still goes to its sink, so when the sink waits on the
+		// owner's thread, as a deferred TextureSink waits for Upload, call
+		// Flush with that pump first.
+		~FramePipeline();
+
+		FramePipeline(const FramePipeline&) = delete;
+		FramePipeline& operator=(const FramePipeline&) = delete;
+
+		// Queues a frame, blocking while the queue is full. An exception thrown
+		// while converting an earlier frame is rethrown here or from Flush.
+		void Submit(DepthFrame frame);
+
+		// Waits until every submitted frame has been converted; needed before
+		// the producer changes the engine or a drawer. pump, if given, runs
+		// while waiting, for sinks that hand frames back to this thread.
+		void Flush(const std::function<void()>& pump = {});
+
+		uint64_t Converted() const;
+
+	private:
+		void Run();
+		void RethrowLocked();
+
+		SIRDSDrawer& engine_;
+		size_t capacity_;
+		mutable std::mutex mutex_;
+		std::condition_variable changed_;
+		std::deque<DepthFrame> queue_;
+		bool busy_ = false;
+		bool stop_ = false;
+		uint64_t converted_ = 0;
+		std::exception_ptr error_;
+		std::thread thread_;  // last, so everything above exists when it starts
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+// Windows types the engine shares with the game. Elsewhere (the benchmark)
+// only the few the engine itself uses are defined, with the same values.
+
+#ifdef _WIN32
+#include "DirectXTex.h"
+#else
+#include <cstddef>
+#include <cstdint>
+
+typedef unsigned int UINT;
+typedef uint32_t UINT32;
+typedef unsigned char BYTE;
+
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32_FLOAT = 41,
+	DXGI_FORMAT_R16_UNORM = 56,
+	DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_B8G8R8X8_UNORM = 88,
+};
+
+namespace DirectX {
+	// Layout of DirectXTex's Image.
+	struct Image {
+		size_t width;
+		size_t height;
+		DXGI_FORMAT format;
+		size_t rowPitch;
+		size_t slicePitch;
+		uint8_t* pixels;
+	};
+}
+#endif
@@ -0,0 +1,153 @@
+// SirdsRandom.cpp
+// Philox4x32-10 counter-based generator used for random dot patterns
+
+#include "SirdsRandom.h"
+#include "SirdsSimd.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace SIRDS::DotRandom
+{
+	namespace {
+		constexpr uint32_t kMul0 = 0xD2511F53u;
+		constexpr uint32_t kMul1 = 0xCD9E8D57u;
+		constexpr uint32_t kWeyl0 = 0x9E3779B9u;
+		constexpr uint32_t kWeyl1 = 0xBB67AE85u;
+		constexpr int kRounds = 10;
+
+		// Stores the 16-bit values for pixels [from, to) of a block starting at x0.
+		void StoreBlock(const uint32_t words[4], int x0, int from, int to, uint16_t* out)
+		{
+			for (int x = from; x < to; x++) {
+				const int k = x - x0;
+				out[x] = static_cast<uint16_t>(words[k >> 1] >> ((k & 1) * 16));
+			}
+		}
+
+#if defined(SIRDS_SSE2)
+		// 32x32 -> 64 bit multiply of all four lanes, split into low and high words.
+		inline void MulHiLo(__m128i a, __m128i m, __m128i& lo, __m128i& hi)
+		{
+			const __m128i p02 = _mm_mul_epu32(a, m);
+			const __m128i p13 = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+			lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(p02, _MM_SHUFFLE(0, 0, 2, 0)),
+				_mm_shuffle_epi32(p13, _MM_SHUFFLE(0, 0, 2, 0)));
+			hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(p02, _MM_SHUFFLE(0, 0, 3, 1)),
+				_mm_shuffle_epi32(p13, _MM_SHUFFLE(0, 0, 3, 1)));
+		}
+
+		// Four consecutive blocks, one per lane, written as 32 pixels.
+		void Blocks4(uint32_t seed, uint32_t y, uint32_t block, uint16_t* out)
+		{
+			const __m128i m0 = _mm_set1_epi32(static_cast<int>(kMul0));
+			const __m128i m1 = _mm_set1_epi32(static_cast<int>(kMul1));
+			const int b = static_cast<int>(block);
+			__m128i c0 = _mm_setr_epi32(b, b + 1, b + 2, b + 3);
+			__m128i c1 = _mm_setzero_si128();
+			__m128i c2 = _mm_setzero_si128();
+			__m128i c3 = _mm_setzero_si128();
+			uint32_t k0 = seed;
+			uint32_t k1 = y;
+			for (int r = 0; r < kRounds; r++) {
+				__m128i lo0, hi0, lo1, hi1;
+				MulHiLo(c0, m0, lo0, hi0);
+				MulHiLo(c2, m1, lo1, hi1);
+				c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(static_cast<int>(k0)));
+				c1 = lo1;
+				c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(static_cast<int>(k1)));
+				c3 = lo0;
+				k0 += kWeyl0;
+				k1 += kWeyl1;
+			}
+			// Transpose so each block's four words are contiguous.
+			const __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+			const __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+			const __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+			const __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+			auto* dst = reinterpret_cast<__m128i*>(out);
+			_mm_storeu_si128(dst + 0, _mm_unpacklo_epi64(t0, t1));
+			_mm_storeu_si128(dst + 1, _mm_unpackhi_epi64(t0, t1));
+			_mm_storeu_si128(dst + 2, _mm_unpacklo_epi64(t2, t3));
+			_mm_storeu_si128(dst + 3, _mm_unpackhi_epi64(t2, t3));
+		}
+#elif defined(SIRDS_NEON)
+		inline void MulHiLo(uint32x4_t a, uint32x2_t m, uint32x4_t& lo, uint32x4_t& hi)
+		{
+			const uint64x2_t p01 = vmull_u32(vget_low_u32(a), m);
+			const uint64x2_t p23 = vmull_u32(vget_high_u32(a), m);
+			lo = vcombine_u32(vmovn_u64(p01), vmovn_u64(p23));
+			hi = vcombine_u32(vshrn_n_u64(p01, 32), vshrn_n_u64(p23, 32));
+		}
+
+		void Blocks4(uint32_t seed, uint32_t y, uint32_t block, uint16_t* out)
+		{
+			const uint32x2_t m0 = vdup_n_u32(kMul0);
+			const uint32x2_t m1 = vdup_n_u32(kMul1);
+			const uint32_t lanes[4] = { block, block + 1, block + 2, block + 3 };
+			uint32x4_t c0 = vld1q_u32(lanes);
+			uint32x4_t c1 = vdupq_n_u32(0);
+			uint32x4_t c2 = vdupq_n_u32(0);
+			uint32x4_t c3 = vdupq_n_u32(0);
+			uint32_t k0 = seed;
+			uint32_t k1 = y;
+			for (int r = 0; r < kRounds; r++) {
+				uint32x4_t lo0, hi0, lo1, hi1;
+				MulHiLo(c0, m0, lo0, hi0);
+				MulHiLo(c2, m1, lo1, hi1);
+				c0 = veorq_u32(veorq_u32(hi1, c1), vdupq_n_u32(k0));
+				c1 = lo1;
+				c2 = veorq_u32(veorq_u32(hi0, c3), vdupq_n_u32(k1));
+				c3 = lo0;
+				k0 += kWeyl0;
+				k1 += kWeyl1;
+			}
+			// Interleaving store puts each block's four words together.
+			uint32x4x4_t words = { { c0, c1, c2, c3 } };
+			vst4q_u32(reinterpret_cast<uint32_t*>(out), words);
+		}
+#endif
+	}
+
+	void Block(uint32_t seed, uint32_t y, uint32_t block, uint32_t out[4])
+	{
+		uint32_t c0 = block, c1 = 0, c2 = 0, c3 = 0;
+		uint32_t k0 = seed;
+		uint32_t k1 = y;
+		for (int r = 0; r < kRounds; r++) {
+			const uint64_t p0 = static_cast<uint64_t>(kMul0) * c0;
+			const uint64_t p1 = static_cast<uint64_t>(kMul1) * c2;
+			c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+			c1 = static_cast<uint32_t>(p1);
+			c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+			c3 = static_cast<uint32_t>(p0);
+			k0 += kWeyl0;
+			k1 += kWeyl1;
+		}
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
+
+	void FillRow(uint32_t seed, uint32_t y, int begin, int end, uint16_t* out)
+	{
+		int x = begin;
+		while (x < end) {
+			const int block = x / kPixelsPerBlock;
+			const int x0 = block * kPixelsPerBlock;
+#if defined(SIRDS_SSE2) || defined(SIRDS_NEON)
+			if (x == x0 && x + 4 * kPixelsPerBlock <= end) {
+				Blocks4(seed, y, static_cast<uint32_t>(block), out + x);
+				x += 4 * kPixelsPerBlock;
+				continue;
+			}
+#endif
+			uint32_t words[4];
+			Block(seed, y, static_cast<uint32_t>(block), words);
+			const int to = min(end, x0 + kPixelsPerBlock);
+			StoreBlock(words, x0, x, to, out);
+			x = to;
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+namespace SIRDS {
+
+	// Counter-based random numbers for the dot fill (Philox4x32-10).
+	// Every value is a pure function of (seed, y, x): rows can be generated by
+	// any thread in any order without shared state, and a seed always
+	// reproduces the same frame.
+	namespace DotRandom {
+		// Each Philox block yields 128 bits, i.e. 16 bits for 8 pixels.
+		constexpr int kPixelsPerBlock = 8;
+
+		// The four output words of block `block` in row y.
+		void Block(uint32_t seed, uint32_t y, uint32_t block, uint32_t out[4]);
+
+		// Writes one 16-bit random value per pixel to out[begin, end). Uses SSE2 or
+		// NEON for whole blocks; the result is bit-identical to the scalar path.
+		void FillRow(uint32_t seed, uint32_t y, int begin, int end, uint16_t* out);
+	}
+}
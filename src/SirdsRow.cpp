@@ -0,0 +1,529 @@
+// SirdsRow.cpp
+// Vectorized per-row kernels for the SIRDS link builder
+
+#include "SirdsRow.h"
+#include "SirdsSimd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace SIRDS
+{
+	void RowSeparations::Resize(int width)
+	{
+		sep.resize(width);
+		right.resize(width);
+		xInRbuf.resize(width);
+		rightSep.resize(width);
+		parent.resize(width);
+		last.resize(width);
+		rank.resize(width);
+	}
+
+	void RowScratch::Prepare(int width)
+	{
+		// resize() keeps the existing storage unless the row got wider.
+		same.resize(width);
+		seps.Resize(width);
+		dots.resize(width);
+		freeColumns.resize(width);
+	}
+
+	void ResetLinks(Link* same, int width)
+	{
+		int x = 0;
+#if defined(SIRDS_AVX2)
+		__m256i v = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		for (; x + 16 <= width; x += 16) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(same + x), v);
+			v = _mm256_add_epi16(v, _mm256_set1_epi16(16));
+		}
+#elif defined(SIRDS_SSE2)
+		__m128i v = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+		for (; x + 8 <= width; x += 8) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(same + x), v);
+			v = _mm_add_epi16(v, _mm_set1_epi16(8));
+		}
+#elif defined(SIRDS_NEON)
+		const uint16_t lanes[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		uint16x8_t v = vld1q_u16(lanes);
+		for (; x + 8 <= width; x += 8) {
+			vst1q_u16(same + x, v);
+			v = vaddq_u16(v, vdupq_n_u16(8));
+		}
+#endif
+		for (; x < width; x++)
+			same[x] = static_cast<Link>(x);
+	}
+
+	namespace {
+		// Scalar reference for columns [begin, end) of the left eye pass.
+		void SeparationsScalar(const float* zll, int begin, int end, const DepthMapping& map, RowSeparations& row)
+		{
+			for (int x = begin; x < end; x++) {
+				row.sep[x] = static_cast<int>(map.Separation(zll[x]));
+				row.xInRbuf[x] = map.RightEyeX(zll[x], x);
+			}
+		}
+
+		// Scalar reference for columns [begin, end) of the right eye / link pass.
+		void LinksScalar(int begin, int end, int width, bool removeHidden, RowSeparations& row)
+		{
+			for (int x = begin; x < end; x++) {
+				const int s = row.sep[x];
+				const int right = x + s;
+				bool linked = right > x && right < width;
+				if (removeHidden) {
+					const int xr = row.xInRbuf[x];
+					const int delta = (xr > 0 && xr < width) ? s - row.rightSep[xr] : 0;
+					linked = linked && delta <= 3 && delta >= -3;
+				}
+				row.right[x] = linked ? right : -1;
+			}
+		}
+
+		// Right eye separation at xr, or 0 for columns the link pass masks out anyway.
+		inline int RightSep(const int* rightSep, int xr, int width)
+		{
+			return (xr > 0 && xr < width) ? rightSep[xr] : 0;
+		}
+	}
+
+	void SeparationRow(const float* z, int width, const DepthMapping& map, int* sep)
+	{
+		int x = 0;
+#if defined(SIRDS_AVX2)
+		{
+			const __m256 sepScale = _mm256_set1_ps(map.sepScale);
+			const __m256 sepBias = _mm256_set1_ps(map.sepBias);
+			for (; x + 8 <= width; x += 8) {
+				const __m256 s = _mm256_add_ps(sepBias, _mm256_mul_ps(sepScale, _mm256_loadu_ps(z + x)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(sep + x), _mm256_cvttps_epi32(s));
+			}
+		}
+#elif defined(SIRDS_SSE2)
+		{
+			const __m128 sepScale = _mm_set1_ps(map.sepScale);
+			const __m128 sepBias = _mm_set1_ps(map.sepBias);
+			for (; x + 4 <= width; x += 4) {
+				const __m128 s = _mm_add_ps(sepBias, _mm_mul_ps(sepScale, _mm_loadu_ps(z + x)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(sep + x), _mm_cvttps_epi32(s));
+			}
+		}
+#elif defined(SIRDS_NEON)
+		{
+			const float32x4_t sepScale = vdupq_n_f32(map.sepScale);
+			const float32x4_t sepBias = vdupq_n_f32(map.sepBias);
+			for (; x + 4 <= width; x += 4)
+				vst1q_s32(sep + x, vcvtq_s32_f32(vaddq_f32(sepBias, vmulq_f32(sepScale, vld1q_f32(z + x)))));
+		}
+#endif
+		for (; x < width; x++)
+			sep[x] = static_cast<int>(map.Separation(z[x]));
+	}
+
+	namespace {
+		// Second pass shared by both depth formats: finds each left pixel's right
+		// partner and drops pairs the right eye cannot see.
+		void LinkPass(int width, bool removeHidden, RowSeparations& row)
+		{
+			int x = 0;
+#if defined(SIRDS_AVX2)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				const __m256i w = _mm256_set1_epi32(width);
+				const __m256i plus3 = _mm256_set1_epi32(3);
+				const __m256i minus3 = _mm256_set1_epi32(-3);
+				const __m256i minus1 = _mm256_set1_epi32(-1);
+				__m256i xi = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+				for (; x + 8 <= width; x += 8) {
+					const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&row.sep[x]));
+					const __m256i right = _mm256_add_epi32(xi, s);
+					__m256i linked = _mm256_and_si256(_mm256_cmpgt_epi32(right, xi), _mm256_cmpgt_epi32(w, right));
+					if (removeHidden) {
+						const __m256i xr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&row.xInRbuf[x]));
+						const __m256i inRight = _mm256_and_si256(_mm256_cmpgt_epi32(xr, zero), _mm256_cmpgt_epi32(w, xr));
+						const __m256i sr = _mm256_mask_i32gather_epi32(zero, row.rightSep.data(), xr, inRight, 4);
+						const __m256i delta = _mm256_and_si256(inRight, _mm256_sub_epi32(s, sr));
+						linked = _mm256_andnot_si256(
+							_mm256_or_si256(_mm256_cmpgt_epi32(delta, plus3), _mm256_cmpgt_epi32(minus3, delta)), linked);
+					}
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row.right[x]),
+						_mm256_or_si256(_mm256_and_si256(linked, right), _mm256_andnot_si256(linked, minus1)));
+					xi = _mm256_add_epi32(xi, _mm256_set1_epi32(8));
+				}
+			}
+#elif defined(SIRDS_SSE2)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i w = _mm_set1_epi32(width);
+				const __m128i plus3 = _mm_set1_epi32(3);
+				const __m128i minus3 = _mm_set1_epi32(-3);
+				const __m128i minus1 = _mm_set1_epi32(-1);
+				const int* rightSep = row.rightSep.data();
+				__m128i xi = _mm_setr_epi32(0, 1, 2, 3);
+				for (; x + 4 <= width; x += 4) {
+					const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row.sep[x]));
+					const __m128i right = _mm_add_epi32(xi, s);
+					__m128i linked = _mm_and_si128(_mm_cmpgt_epi32(right, xi), _mm_cmpgt_epi32(w, right));
+					if (removeHidden) {
+						const int* xrp = &row.xInRbuf[x];
+						const __m128i xr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xrp));
+						const __m128i inRight = _mm_and_si128(_mm_cmpgt_epi32(xr, zero), _mm_cmpgt_epi32(w, xr));
+						const __m128i sr = _mm_setr_epi32(RightSep(rightSep, xrp[0], width), RightSep(rightSep, xrp[1], width),
+							RightSep(rightSep, xrp[2], width), RightSep(rightSep, xrp[3], width));
+						const __m128i delta = _mm_and_si128(inRight, _mm_sub_epi32(s, sr));
+						linked = _mm_andnot_si128(
+							_mm_or_si128(_mm_cmpgt_epi32(delta, plus3), _mm_cmpgt_epi32(minus3, delta)), linked);
+					}
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(&row.right[x]),
+						_mm_or_si128(_mm_and_si128(linked, right), _mm_andnot_si128(linked, minus1)));
+					xi = _mm_add_epi32(xi, _mm_set1_epi32(4));
+				}
+			}
+#elif defined(SIRDS_NEON)
+			{
+				const int32x4_t zero = vdupq_n_s32(0);
+				const int32x4_t w = vdupq_n_s32(width);
+				const int32x4_t plus3 = vdupq_n_s32(3);
+				const int32x4_t minus3 = vdupq_n_s32(-3);
+				const int32x4_t minus1 = vdupq_n_s32(-1);
+				const int* rightSep = row.rightSep.data();
+				const int lanes[4] = { 0, 1, 2, 3 };
+				int32x4_t xi = vld1q_s32(lanes);
+				for (; x + 4 <= width; x += 4) {
+					const int32x4_t s = vld1q_s32(&row.sep[x]);
+					const int32x4_t right = vaddq_s32(xi, s);
+					uint32x4_t linked = vandq_u32(vcgtq_s32(right, xi), vcgtq_s32(w, right));
+					if (removeHidden) {
+						const int* xrp = &row.xInRbuf[x];
+						const int32x4_t xr = vld1q_s32(xrp);
+						const uint32x4_t inRight = vandq_u32(vcgtq_s32(xr, zero), vcgtq_s32(w, xr));
+						const int seps[4] = { RightSep(rightSep, xrp[0], width), RightSep(rightSep, xrp[1], width),
+							RightSep(rightSep, xrp[2], width), RightSep(rightSep, xrp[3], width) };
+						const int32x4_t delta = vbslq_s32(inRight, vsubq_s32(s, vld1q_s32(seps)), zero);
+						linked = vandq_u32(linked, vandq_u32(vcleq_s32(delta, plus3), vcgeq_s32(delta, minus3)));
+					}
+					vst1q_s32(&row.right[x], vbslq_s32(linked, right, minus1));
+					xi = vaddq_s32(xi, vdupq_n_s32(4));
+				}
+			}
+#endif
+			LinksScalar(x, width, width, removeHidden, row);
+		}
+	}
+
+	void BuildRowSeparations(const float* zll, const float* zlr, int width, const DepthMapping& map,
+		bool removeHidden, RowSeparations& row)
+	{
+		int x = 0;
+
+#if defined(SIRDS_AVX2)
+		{
+			const __m256 sepScale = _mm256_set1_ps(map.sepScale);
+			const __m256 sepBias = _mm256_set1_ps(map.sepBias);
+			const __m256 shiftScale = _mm256_set1_ps(map.shiftScale);
+			const __m256 shiftBias = _mm256_set1_ps(map.shiftBias);
+			__m256 xf = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+			for (; x + 8 <= width; x += 8) {
+				const __m256 z = _mm256_loadu_ps(zll + x);
+				const __m256i s = _mm256_cvttps_epi32(_mm256_add_ps(sepBias, _mm256_mul_ps(sepScale, z)));
+				const __m256 shift = _mm256_add_ps(shiftBias, _mm256_mul_ps(shiftScale, z));
+				const __m256i xr = _mm256_cvttps_epi32(_mm256_sub_ps(xf, shift));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row.sep[x]), s);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row.xInRbuf[x]), xr);
+				xf = _mm256_add_ps(xf, _mm256_set1_ps(8.f));
+			}
+		}
+#elif defined(SIRDS_SSE2)
+		{
+			const __m128 sepScale = _mm_set1_ps(map.sepScale);
+			const __m128 sepBias = _mm_set1_ps(map.sepBias);
+			const __m128 shiftScale = _mm_set1_ps(map.shiftScale);
+			const __m128 shiftBias = _mm_set1_ps(map.shiftBias);
+			__m128 xf = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+			for (; x + 4 <= width; x += 4) {
+				const __m128 z = _mm_loadu_ps(zll + x);
+				const __m128i s = _mm_cvttps_epi32(_mm_add_ps(sepBias, _mm_mul_ps(sepScale, z)));
+				const __m128 shift = _mm_add_ps(shiftBias, _mm_mul_ps(shiftScale, z));
+				const __m128i xr = _mm_cvttps_epi32(_mm_sub_ps(xf, shift));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&row.sep[x]), s);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&row.xInRbuf[x]), xr);
+				xf = _mm_add_ps(xf, _mm_set1_ps(4.f));
+			}
+		}
+#elif defined(SIRDS_NEON)
+		{
+			const float32x4_t sepScale = vdupq_n_f32(map.sepScale);
+			const float32x4_t sepBias = vdupq_n_f32(map.sepBias);
+			const float32x4_t shiftScale = vdupq_n_f32(map.shiftScale);
+			const float32x4_t shiftBias = vdupq_n_f32(map.shiftBias);
+			const float lanes[4] = { 0.f, 1.f, 2.f, 3.f };
+			float32x4_t xf = vld1q_f32(lanes);
+			for (; x + 4 <= width; x += 4) {
+				const float32x4_t z = vld1q_f32(zll + x);
+				const int32x4_t s = vcvtq_s32_f32(vaddq_f32(sepBias, vmulq_f32(sepScale, z)));
+				const float32x4_t shift = vaddq_f32(shiftBias, vmulq_f32(shiftScale, z));
+				const int32x4_t xr = vcvtq_s32_f32(vsubq_f32(xf, shift));
+				vst1q_s32(&row.sep[x], s);
+				vst1q_s32(&row.xInRbuf[x], xr);
+				xf = vaddq_f32(xf, vdupq_n_f32(4.f));
+			}
+		}
+#endif
+		SeparationsScalar(zll, x, width, map, row);
+		// Column 0 never looks into the right buffer.
+		if (width > 0)
+			row.xInRbuf[0] = 0;
+
+		// Each right eye pixel is converted once; the occlusion test is then a
+		// lookup of the pixel the left eye column sees.
+		if (removeHidden)
+			SeparationRow(zlr, width, map, row.rightSep.data());
+
+		LinkPass(width, removeHidden, row);
+	}
+
+	void DepthTable::Build(const DepthMapping& mapping)
+	{
+		if (!sep.empty() && map == mapping)
+			return;
+		map = mapping;
+		sep.resize(65536);
+		shift.resize(65536);
+		for (int d = 0; d < 65536; d++) {
+			const float zp = static_cast<float>(d) / 65535.f;
+			sep[d] = static_cast<int>(mapping.Separation(zp));
+			shift[d] = static_cast<int>(lround(static_cast<double>(mapping.shiftBias + mapping.shiftScale * zp) * (1 << kShiftBits)));
+		}
+	}
+
+	void BuildRowSeparations(const uint16_t* zll, const uint16_t* zlr, int width, const DepthTable& table,
+		bool removeHidden, RowSeparations& row)
+	{
+		const int* sepTable = table.sep.data();
+		const int* shiftTable = table.shift.data();
+		constexpr int bits = DepthTable::kShiftBits;
+		int x = 0;
+
+		// Two table lookups per pixel. SSE2 and NEON have no gather, so only
+		// AVX2 gets a vector loop; the link pass below is vectorized everywhere.
+#if defined(SIRDS_AVX2)
+		{
+			__m256i xi = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			for (; x + 8 <= width; x += 8) {
+				const __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(zll + x)));
+				const __m256i s = _mm256_i32gather_epi32(sepTable, d, 4);
+				const __m256i shift = _mm256_i32gather_epi32(shiftTable, d, 4);
+				const __m256i xr = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_slli_epi32(xi, bits), shift), bits);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row.sep[x]), s);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row.xInRbuf[x]), xr);
+				xi = _mm256_add_epi32(xi, _mm256_set1_epi32(8));
+			}
+		}
+#endif
+		for (; x < width; x++) {
+			row.sep[x] = sepTable[zll[x]];
+			row.xInRbuf[x] = ((x << bits) - shiftTable[zll[x]]) >> bits;
+		}
+		if (width > 0)
+			row.xInRbuf[0] = 0;
+
+		if (removeHidden) {
+			int* rightSep = row.rightSep.data();
+			x = 0;
+#if defined(SIRDS_AVX2)
+			for (; x + 8 <= width; x += 8) {
+				const __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(zlr + x)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(rightSep + x), _mm256_i32gather_epi32(sepTable, d, 4));
+			}
+#endif
+			for (; x < width; x++)
+				rightSep[x] = sepTable[zlr[x]];
+		}
+
+		LinkPass(width, removeHidden, row);
+	}
+
+	namespace {
+		void SolveWalk(const int* rights, int width, Link* same)
+		{
+			// Highest pixel whose link has been written. Anything past it still links
+			// to itself, so a pair landing there needs no walk at all.
+			int maxLinked = -1;
+			for (int left = 0; left < width;) {
+				const int right = rights[left];
+				if (right < 0) {
+					left++;
+					continue;
+				}
+
+				if (right > maxLinked) {
+					// Span of constant separation: every right partner is fresh, so the
+					// links are written straight through until the separation changes.
+					const int s = right - left;
+					int spanEnd = left + 1;
+					while (spanEnd < width && rights[spanEnd] == spanEnd + s)
+						spanEnd++;
+					for (int l = left; l < spanEnd; l++)
+						same[l + s] = static_cast<Link>(l);
+					maxLinked = spanEnd - 1 + s;
+					left = spanEnd;
+					continue;
+				}
+
+				int sl = left;
+				int sr = right;
+				for (int st = same[sr]; st != sl && st != sr; st = same[sr]) {
+					if (st > sl) {
+						sr = st;
+					}
+					else {
+						same[sr] = static_cast<Link>(sl);
+						maxLinked = max(maxLinked, sr);
+						sr = sl;
+						sl = st;
+					}
+				}
+				same[sr] = static_cast<Link>(sl);
+				maxLinked = max(maxLinked, sr);
+				left++;
+			}
+		}
+
+		constexpr Link kNoMember = 0xFFFF;  // never a pixel, as rows are at most kMaxRowWidth wide
+
+		inline int Find(Link* parent, int x)
+		{
+			while (parent[x] != x) {
+				parent[x] = parent[parent[x]];
+				x = parent[x];
+			}
+			return x;
+		}
+
+		void SolveUnionFind(RowSeparations& row, int width, Link* same)
+		{
+			const int* rights = row.right.data();
+			Link* parent = row.parent.data();
+			Link* last = row.last.data();
+			uint8_t* rank = row.rank.data();
+			ResetLinks(parent, width);
+			fill(last, last + width, kNoMember);
+			fill(rank, rank + width, uint8_t(0));
+
+			for (int left = 0; left < width; left++) {
+				if (rights[left] < 0)
+					continue;
+				int a = Find(parent, left);
+				int b = Find(parent, rights[left]);
+				if (a == b)
+					continue;
+				if (rank[a] < rank[b])
+					swap(a, b);
+				parent[b] = static_cast<Link>(a);
+				if (rank[a] == rank[b])
+					rank[a]++;
+			}
+
+			// Link each pixel to the previous member of its class rather than the
+			// root, so flat spans keep the constant offset the fills copy in runs.
+			for (int x = 0; x < width; x++) {
+				const int root = Find(parent, x);
+				if (last[root] != kNoMember)
+					same[x] = last[root];
+				last[root] = static_cast<Link>(x);
+			}
+		}
+
+		// Leftmost pixel each pixel takes its colour from, or -1 when the fill
+		// would read a pixel to its right.
+		void ResolveLinks(const Link* same, int width, vector<int>& rep)
+		{
+			rep.resize(width);
+			for (int x = 0; x < width; x++) {
+				const int f = same[x];
+				rep[x] = f == x ? x : f < x ? rep[f] : -1;
+			}
+		}
+	}
+
+	void SolveLinks(LinkSolver solver, RowSeparations& row, int width, Link* same)
+	{
+		if (solver == LinkSolver::UnionFind)
+			SolveUnionFind(row, width, same);
+		else
+			SolveWalk(row.right.data(), width, same);
+	}
+
+	bool VerifyLinkSolvers(RowSeparations& row, int width)
+	{
+		vector<Link> walk(width), unionFind(width);
+		ResetLinks(walk.data(), width);
+		ResetLinks(unionFind.data(), width);
+		SolveLinks(LinkSolver::Walk, row, width, walk.data());
+		SolveLinks(LinkSolver::UnionFind, row, width, unionFind.data());
+
+		vector<int> repWalk, repUnionFind;
+		ResolveLinks(walk.data(), width, repWalk);
+		ResolveLinks(unionFind.data(), width, repUnionFind);
+		for (int x = 0; x < width; x++) {
+			if (repWalk[x] < 0 || repWalk[x] != repUnionFind[x])
+				return false;
+		}
+		return true;
+	}
+
+	namespace {
+		constexpr uint64_t kHashMul = 0x9E3779B97F4A7C15ull;
+
+		inline uint64_t Mix(uint64_t h)
+		{
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ull;
+			h ^= h >> 32;
+			return h;
+		}
+
+		// Four independent lanes so the multiplies overlap; each step is a
+		// bijection of the lane, so a single changed word always changes it.
+		// Hashes count 32 bit words; a trailing half word is zero padded.
+		uint64_t HashWords(const void* data, int count, uint64_t seed)
+		{
+			const char* p = static_cast<const char*>(data);
+			uint64_t h[4] = { seed, seed + 1, seed + 2, seed + 3 };
+			int i = 0;
+			for (; i + 8 <= count; i += 8) {
+				uint64_t w[4];
+				memcpy(w, p + i * 4, sizeof(w));
+				h[0] = (h[0] ^ w[0]) * kHashMul;
+				h[1] = (h[1] ^ w[1]) * kHashMul;
+				h[2] = (h[2] ^ w[2]) * kHashMul;
+				h[3] = (h[3] ^ w[3]) * kHashMul;
+			}
+			for (int lane = 0; i < count; i++, lane = (lane + 1) & 3) {
+				uint32_t w;
+				memcpy(&w, p + i * 4, sizeof(w));
+				h[lane] = (h[lane] ^ w) * kHashMul;
+			}
+			return Mix(h[0] ^ Mix(h[1] ^ Mix(h[2] ^ Mix(h[3] ^ static_cast<uint64_t>(count)))));
+		}
+	}
+
+	uint64_t RowFingerprint(const float* zll, const float* zlr, int width)
+	{
+		return HashWords(zlr, width, HashWords(zll, width, 0));
+	}
+
+	uint64_t RowFingerprint(const uint16_t* zll, const uint16_t* zlr, int width)
+	{
+		// Pairs of depth values hash as one word; an odd last value gets its own.
+		const int words = width / 2;
+		uint64_t h = HashWords(zlr, words, HashWords(zll, words, 0));
+		if (width & 1)
+			h = Mix((h ^ zll[width - 1] ^ (static_cast<uint64_t>(zlr[width - 1]) << 16)) * kHashMul);
+		return h;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SIRDS {
+
+	// Index of the pixel a pixel takes its colour from (itself when free).
+	// Rows are limited to kMaxRowWidth pixels so a link fits in 16 bits.
+	using Link = uint16_t;
+	constexpr int kMaxRowWidth = 65535;
+
+	// Affine depth -> separation mapping cached by SIRDSDrawer::InitStatics.
+	struct DepthMapping {
+		float sepScale = 0.f;
+		float sepBias = 0.f;
+		float shiftScale = 0.f;
+		float shiftBias = 0.f;
+
+		// Separation in pixels for a raw depth buffer value.
+		float Separation(float zp) const
+		{
+			return sepBias + sepScale * zp;
+		}
+
+		// Column in the right eye buffer seen through left eye column x.
+		int RightEyeX(float zp, int x) const
+		{
+			return static_cast<int>(static_cast<float>(x) - (shiftBias + shiftScale * zp));
+		}
+
+		bool operator==(const DepthMapping& o) const
+		{
+			return sepScale == o.sepScale && sepBias == o.sepBias && shiftScale == o.shiftScale && shiftBias == o.shiftBias;
+		}
+		bool operator!=(const DepthMapping& o) const { return !(*this == o); }
+	};
+
+	// Integer form of a DepthMapping for 16 bit UNORM depth, one entry per
+	// depth value. Rows built from it use no floating point at all, so they
+	// come out the same from every compiler and SIMD width.
+	struct DepthTable {
+		// x << kShiftBits must fit an int for every x below kMaxRowWidth.
+		static constexpr int kShiftBits = 12;
+
+		std::vector<int> sep;    // separation in pixels
+		std::vector<int> shift;  // right eye shift in kShiftBits fixed point
+		DepthMapping map;        // mapping the table was built from
+
+		// Rebuilds the table unless it already matches map.
+		void Build(const DepthMapping& mapping);
+	};
+
+	// Per-row output of BuildRowSeparations, consumed by the link builder.
+	struct RowSeparations {
+		std::vector<int> sep;      // integer separation s at each left pixel
+		std::vector<int> right;    // left + s when the pair should be linked, otherwise -1
+		std::vector<int> xInRbuf;  // right eye buffer column seen from each left pixel
+		std::vector<int> rightSep; // separation of each right eye pixel (removeHidden only)
+
+		// Union-find scratch for LinkSolver::UnionFind.
+		std::vector<Link> parent;
+		std::vector<Link> last;
+		std::vector<uint8_t> rank;
+
+		void Resize(int width);
+	};
+
+	// Per-worker row scratch. Sized once per resolution and reused for every
+	// row the worker handles, so steady-state frames do not allocate.
+	struct RowScratch {
+		std::vector<Link> same;
+		RowSeparations seps;
+		std::vector<uint16_t> dots;  // per-pixel random bits, filled by the pattern kernels
+		std::vector<Link> freeColumns;  // unlinked columns, for kernels that shade them in bulk
+		std::vector<uint64_t> cells;  // bit-packed automaton rows, sized by the kernel
+
+		void Prepare(int width);
+	};
+
+	// Resets same[0, width) to the identity (every pixel linked to itself).
+	void ResetLinks(Link* same, int width);
+
+	// Integer separation of every pixel in one depth row.
+	void SeparationRow(const float* z, int width, const DepthMapping& map, int* sep);
+
+	// Converts one row of left/right depth into separations and link targets.
+	// Uses AVX2, SSE2 or NEON when available; every path gives the same result.
+	void BuildRowSeparations(const float* zll, const float* zlr, int width, const DepthMapping& map,
+		bool removeHidden, RowSeparations& row);
+
+	// Same as above for 16 bit UNORM depth, using the integer table.
+	void BuildRowSeparations(const uint16_t* zll, const uint16_t* zlr, int width, const DepthTable& table,
+		bool removeHidden, RowSeparations& row);
+
+	enum class LinkSolver {
+		Walk,       // the original same[] chain walk; cost depends on chain length
+		UnionFind,  // union by rank with path halving, O(width * alpha) per row
+	};
+
+	// Links every pair in row.right into same[0, width), which must start as
+	// the identity. Both solvers put each pixel in the same class with the
+	// same leftmost member, so a fill draws the same row from either.
+	void SolveLinks(LinkSolver solver, RowSeparations& row, int width, Link* same);
+
+	// Runs both solvers on row.right and checks that every pixel resolves to
+	// the same leftmost pixel. BuildRowSeparations only pairs a pixel with one
+	// on its right, so neither solver may link a pixel forward.
+	bool VerifyLinkSolvers(RowSeparations& row, int width);
+
+	// 64 bit fingerprint of one row of left and right depth, used to spot rows
+	// that did not change since the previous frame.
+	uint64_t RowFingerprint(const float* zll, const float* zlr, int width);
+	uint64_t RowFingerprint(const uint16_t* zll, const uint16_t* zlr, int width);
+}
@@ -0,0 +1,183 @@
+// SirdsScheduler.cpp
+// Band-based work-stealing scheduler for the SIRDS row stage
+
+#include "SirdsScheduler.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace SIRDS
+{
+	namespace {
+		inline uint64_t Pack(uint32_t front, uint32_t back)
+		{
+			return (static_cast<uint64_t>(front) << 32) | back;
+		}
+
+		inline uint32_t Front(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+		inline uint32_t Back(uint64_t range) { return static_cast<uint32_t>(range); }
+	}
+
+	BandScheduler::BandScheduler(int workers)
+	{
+		Start(workers);
+	}
+
+	BandScheduler::~BandScheduler()
+	{
+		Stop();
+	}
+
+	void BandScheduler::SetWorkers(int workers)
+	{
+		const int wanted = workers > 0 ? workers : static_cast<int>(max(1u, thread::hardware_concurrency()));
+		if (wanted == workers_ && queues_)
+			return;
+		Stop();
+		Start(workers);
+	}
+
+	void BandScheduler::Start(int workers)
+	{
+		workers_ = workers > 0 ? workers : static_cast<int>(max(1u, thread::hardware_concurrency()));
+		queues_ = make_unique<BandQueue[]>(workers_);
+		stop_ = false;
+		threads_.reserve(workers_ - 1);
+		for (int w = 1; w < workers_; w++)
+			threads_.emplace_back(&BandScheduler::WorkerLoop, this, w, generation_);
+	}
+
+	void BandScheduler::Stop()
+	{
+		{
+			lock_guard<mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& t : threads_)
+			t.join();
+		threads_.clear();
+	}
+
+	// seen is the generation at Start, so a worker added after earlier jobs
+	// waits for the next one instead of running a finished job.
+	void BandScheduler::WorkerLoop(int worker, uint64_t seen)
+	{
+		for (;;) {
+			const function<void(int)>* job;
+			{
+				unique_lock<mutex> lock(mutex_);
+				wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+				if (stop_)
+					return;
+				seen = generation_;
+				job = job_;
+			}
+
+			exception_ptr error;
+			try {
+				(*job)(worker);
+			}
+			catch (...) {
+				error = current_exception();
+			}
+
+			lock_guard<mutex> lock(mutex_);
+			if (error && !error_)
+				error_ = error;
+			if (--pending_ == 0)
+				done_.notify_one();
+		}
+	}
+
+	void BandScheduler::Run(const function<void(int)>& job)
+	{
+		{
+			lock_guard<mutex> lock(mutex_);
+			job_ = &job;
+			pending_ = workers_ - 1;
+			error_ = nullptr;
+			++generation_;
+		}
+		wake_.notify_all();
+
+		exception_ptr error;
+		try {
+			job(0);
+		}
+		catch (...) {
+			error = current_exception();
+		}
+
+		unique_lock<mutex> lock(mutex_);
+		done_.wait(lock, [&] { return pending_ == 0; });
+		job_ = nullptr;
+		if (!error)
+			error = error_;
+		if (error)
+			rethrow_exception(error);
+	}
+
+	bool BandScheduler::TakeFront(int worker, int& band)
+	{
+		auto& range = queues_[worker].range;
+		uint64_t current = range.load(memory_order_relaxed);
+		while (Front(current) < Back(current)) {
+			if (range.compare_exchange_weak(current, Pack(Front(current) + 1, Back(current)), memory_order_acq_rel)) {
+				band = static_cast<int>(Front(current));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool BandScheduler::StealBack(int worker, int& band)
+	{
+		for (int i = 1; i < workers_; i++) {
+			auto& range = queues_[(worker + i) % workers_].range;
+			uint64_t current = range.load(memory_order_relaxed);
+			while (Front(current) < Back(current)) {
+				if (range.compare_exchange_weak(current, Pack(Front(current), Back(current) - 1), memory_order_acq_rel)) {
+					band = static_cast<int>(Back(current) - 1);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void BandScheduler::ForBands(int rows, int bandRows, const function<void(int, int, int)>& body)
+	{
+		if (rows <= 0)
+			return;
+		bandRows = max(1, bandRows);
+		const int bands = (rows + bandRows - 1) / bandRows;
+
+		// Contiguous runs keep each worker on neighbouring rows until it has to steal.
+		for (int w = 0; w < workers_; w++) {
+			const auto front = static_cast<uint32_t>(static_cast<int64_t>(bands) * w / workers_);
+			const auto back = static_cast<uint32_t>(static_cast<int64_t>(bands) * (w + 1) / workers_);
+			queues_[w].range.store(Pack(front, back), memory_order_relaxed);
+		}
+
+		Run([&](int worker) {
+			int band;
+			while (TakeFront(worker, band) || StealBack(worker, band)) {
+				const int begin = band * bandRows;
+				body(worker, begin, min(rows, begin + bandRows));
+			}
+		});
+	}
+
+	void BandScheduler::ForWorkers(const function<void(int)>& body)
+	{
+		Run(body);
+	}
+
+	int BandScheduler::BandRowsFor(int bytesPerRow, int l2Bytes)
+	{
+		if (bytesPerRow <= 0)
+			return 1;
+		return max(1, l2Bytes / bytesPerRow);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SIRDS {
+
+	// Persistent std::thread pool that splits rows into contiguous bands.
+	// Each worker starts on its own run of bands and steals from the far end of
+	// the others' runs once it is done, so cheap background rows and expensive
+	// rows full of columns balance out without per-row scheduling.
+	class BandScheduler
+	{
+	public:
+		// Rough per-core L2 size used to pick a band height.
+		static constexpr int kDefaultL2Bytes = 1 << 20;
+
+		explicit BandScheduler(int workers = 0);
+		~BandScheduler();
+
+		BandScheduler(const BandScheduler&) = delete;
+		BandScheduler& operator=(const BandScheduler&) = delete;
+
+		// 0 selects std::thread::hardware_concurrency(). The calling thread is
+		// worker 0, so workers - 1 threads are started.
+		void SetWorkers(int workers);
+		int Workers() const { return workers_; }
+
+		// Calls body(worker, begin, end) for bands of bandRows rows covering [0, rows).
+		void ForBands(int rows, int bandRows, const std::function<void(int worker, int begin, int end)>& body);
+
+		// Calls body(worker) once on every worker, all running at the same time.
+		void ForWorkers(const std::function<void(int worker)>& body);
+
+		// Rows per band so that one band of bytesPerRow rows fits in l2Bytes.
+		static int BandRowsFor(int bytesPerRow, int l2Bytes = kDefaultL2Bytes);
+
+	private:
+		// Remaining bands of one worker, packed as (front << 32) | back so the
+		// owner (front) and thieves (back) can both claim with a single CAS.
+		struct alignas(64) BandQueue {
+			std::atomic<uint64_t> range{ 0 };
+		};
+
+		void Start(int workers);
+		void Stop();
+		void Run(const std::function<void(int)>& job);
+		void WorkerLoop(int worker, uint64_t seen);
+		bool TakeFront(int worker, int& band);
+		bool StealBack(int worker, int& band);
+
+		int workers_ = 1;
+		std::vector<std::thread> threads_;
+		std::unique_ptr<BandQueue[]> queues_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		const std::function<void(int)>* job_ = nullptr;
+		uint64_t generation_ = 0;
+		int pending_ = 0;
+		bool stop_ = false;
+		std::exception_ptr error_;
+	};
+}
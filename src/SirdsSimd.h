@@ -0,0 +1,15 @@
+#pragma once
+
+// Picks the SIMD instruction sets the compiler is targeting. AVX2 builds also
+// get SSE2; ARM builds get NEON. Kernels keep a scalar path for everything else.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIRDS_AVX2
+#endif
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIRDS_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIRDS_NEON
+#endif
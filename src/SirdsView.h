@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace SIRDS {
+	// Non-owning 2D view of depth or pixels. Rows are rowPitch bytes apart, so
+	// padded captures and mapped memory can be read and written in place.
+	template <class T>
+	struct ImageView {
+		T* data = nullptr;
+		int width = 0;
+		int height = 0;
+		size_t rowPitch = 0;  // bytes from the start of one row to the next
+
+		ImageView() = default;
+		ImageView(T* pixels, int w, int h, size_t pitch) : data(pixels), width(w), height(h), rowPitch(pitch) {}
+		ImageView(T* pixels, int w, int h) : ImageView(pixels, w, h, static_cast<size_t>(w) * sizeof(T)) {}
+
+		// A view of T can be passed where a view of const T is expected.
+		template <class U, class = std::enable_if_t<std::is_same_v<const U, T>>>
+		ImageView(const ImageView<U>& o) : data(o.data), width(o.width), height(o.height), rowPitch(o.rowPitch) {}
+
+		T* Row(int y) const
+		{
+			using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+			return reinterpret_cast<T*>(reinterpret_cast<Byte*>(data) + static_cast<size_t>(y) * rowPitch);
+		}
+
+		bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+	};
+
+	using PixelView = ImageView<uint32_t>;
+
+	// Caller-owned destination for a frame. The engine draws every row straight
+	// into the view BeginFrame returns, so the sink sees final pixels without
+	// an intermediate copy. Rows whose depth did not change are left untouched,
+	// so a sink that hands out the same buffer each frame keeps them for free.
+	class FrameSink {
+	public:
+		virtual ~FrameSink() = default;
+		virtual PixelView BeginFrame(int width, int height) = 0;
+		// Every row of the view is final.
+		virtual void EndFrame() = 0;
+	};
+
+	// View of a tightly packed width * height buffer.
+	template <class T>
+	ImageView<const T> ViewOf(const std::vector<T>& v, int width, int height)
+	{
+		return ImageView<const T>(v.data(), width, height);
+	}
+}
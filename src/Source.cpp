@@ -11,18 +11,14 @@
 #include <WinBase.h>
 #include "FlappyData.h"
 #include "SirdsDrawer.h"
-
-#define MYRAND (rand())
+#include "SirdsRow.h"
+#include "SirdsView.h"
+#include "SirdsRandom.h"
 
 using namespace std;
 using namespace concurrency;
 using namespace DirectX;
 
-using Llist = struct {
-	int t;
-	int f;
-};
-
 class SirdsDrawer
 {
 public:
@@ -44,60 +40,62 @@ public:
 		m_width = iWidth_;
 		m_height = iHeight_;
 		pmm = params.pmm;
-		pixels.resize(m_width * m_height);
 		zNear = params.zNear;
 		zFar = params.zFar;
 	}
 
-	// Same signature as before
+	// Same signature as before. iPixels is drawn into directly.
 	void ZBuffersToDrawer(vector<float>& lzbuf, vector<float>& rzbuf, vector<UINT>& iPixels, bool hidden)
+	{
+		iPixels.resize(static_cast<size_t>(m_width) * m_height);
+		ZBuffersToDrawer(lzbuf, rzbuf, SIRDS::PixelView(iPixels.data(), m_width, m_height), hidden);
+	}
+
+	// Draws every row straight into the caller's pixels; out must be m_width x m_height.
+	void ZBuffersToDrawer(vector<float>& lzbuf, vector<float>& rzbuf, SIRDS::PixelView out, bool hidden)
 	{
 		int widthLocal = m_width;
 		int heightLocal = m_height;
+		uint32_t seed = frameSeed++;
 
-		vector<Llist> sameStart;
-		sameStart.resize(widthLocal);
-		for (int x = 0; x < widthLocal; x++) {
-			sameStart[x].t = x;
-			sameStart[x].f = x;
-		}
-
-		parallel_for(0, heightLocal, [&lzbuf, &rzbuf, &sameStart, this, widthLocal, hidden](int y) {
-			vector<Llist> same;
-			same = sameStart;
+		parallel_for(0, heightLocal, [&lzbuf, &rzbuf, this, widthLocal, hidden, seed, out](int y) {
+			// Per-thread row, allocated once per resolution and reset per row.
+			SIRDS::RowScratch& row = rowScratch.local();
+			row.Prepare(widthLocal);
+			SIRDS::ResetLinks(row.same.data(), widthLocal);
 			auto zll = &lzbuf[y * widthLocal];
 			auto zlr = &rzbuf[y * widthLocal];
-			sirdsnew(zll, zlr, same, hidden);
-			SirdsPicAlgo(y, same);
+			sirdsnew(zll, zlr, row, hidden);
+			SirdsPicAlgo(y, seed, row, out.Row(y));
 			});
-		iPixels = pixels;
 	}
 
 private:
 	// private ctor to enforce singleton
-	SirdsDrawer()
-	{
-		pixels.clear();
-	}
+	SirdsDrawer() = default;
 
 	// preserve copy/move disabled
 	SirdsDrawer(const SirdsDrawer&) = delete;
 	SirdsDrawer& operator=(const SirdsDrawer&) = delete;
 
 	/* SIRDS algorithm helpers (converted to members) */
-	float Lookup(float zp, int x, int& x1) const
+	float DepthToZ(float zp) const
 	{
-		float z = ((-zNear * zFar) / (zFar - zNear))
+		return ((-zNear * zFar) / (zFar - zNear))
 			/ (zp - 0.5f - (zNear + zFar) / (2.0f * (zFar - zNear)));
-		float v;
+	}
+
+	float Separation(float z) const
+	{
 		if (bReverse)
-		{
-			v = height * es * (vd - z) / z;
-		}
-		else
-		{
-			v = height * es * (z - vd) / z;
-		}
+			return height * es * (vd - z) / z;
+		return height * es * (z - vd) / z;
+	}
+
+	float Lookup(float zp, int x, int& x1) const
+	{
+		float z = DepthToZ(zp);
+		float v = Separation(z);
 		float xvd = ((float)x - width) / height;
 		xvd *= z / vd;
 		xvd -= es;
@@ -106,53 +104,52 @@ private:
 		return v;
 	}
 
-	void sirdsnew(float* zll, float* zlr, vector<Llist>& same, bool removeHidden)
+	void sirdsnew(float* zll, float* zlr, SIRDS::RowScratch& row, bool removeHidden)
 	{
 		int widthLocal = m_width;
 		int xInRbuf;
-		int xNotUsed;
+		int* rights = row.seps.right.data();
+		int* rightSep = row.seps.rightSep.data();
+
+		// Convert the right eye row once instead of once per left pixel.
+		if (removeHidden) {
+			for (int x = 0; x < widthLocal; x++)
+				rightSep[x] = (int)Separation(DepthToZ(zlr[x]));
+		}
 
 		for (int left = 0; left < widthLocal; left++) {
+			rights[left] = -1;
 			auto s = (int)Lookup(zll[left], left, xInRbuf);
 			auto right = left + s;
-			if (right > 0 && right < widthLocal) {
+			if (right > left && right < widthLocal) {
+				if (!removeHidden) {
+					rights[left] = right;
+					continue;
+				}
 				if (xInRbuf > 0 && xInRbuf < widthLocal)
-					s -= (int)Lookup(zlr[xInRbuf], xInRbuf, xNotUsed);
+					s -= rightSep[xInRbuf];
 				else
 					s = 0;
-				if (!removeHidden || (s <= 3 && s >= -3)) {
-					auto sl = left; 
-					auto sr = right;
-					for (int st = same[sr].f; st != sl && st != sr; st = same[sr].f) {
-						if (st > sl) {
-							sr = st;
-						}
-						else {
-							same[sl].t = sr;
-							same[sr].f = sl;
-							sr = sl;
-							sl = st;
-						}
-					}
-					same[sl].t = sr;
-					same[sr].f = sl;
-				}
+				if (s <= 3 && s >= -3)
+					rights[left] = right;
 			}
 		}
+		SIRDS::SolveLinks(linkSolver, row.seps, widthLocal, row.same.data());
 	}
 
-	void SirdsPicAlgo(int y, std::vector<Llist>& same)
+	void SirdsPicAlgo(int y, uint32_t seed, SIRDS::RowScratch& row, UINT32* pa)
 	{
-		UINT32* pv = &pixels[0];
-		UINT32* pa = &pv[y * m_width];
+		const auto& same = row.same;
+		const uint16_t* dots = row.dots.data();
+		SIRDS::DotRandom::FillRow(seed, y, 0, m_width, row.dots.data());
 
 		for (UINT x = 0; x < same.size(); x++) {
-			if (UINT pixpos = same[x].f;
+			if (UINT pixpos = same[x];
 				pixpos != x) {
 				pa[x] = pa[pixpos];
 				continue;
 			}
-			pa[x] = (((rand() & 0xff) > m_Density) ? color1 : color2);
+			pa[x] = (((dots[x] & 0xff) > m_Density) ? color1 : color2);
 		}
 	}
 
@@ -173,5 +170,7 @@ private:
 	float zNear;
 	float zFar;
 
-	vector<UINT32> pixels;
+	uint32_t frameSeed = 1;
+	SIRDS::LinkSolver linkSolver = SIRDS::LinkSolver::Walk;
+	combinable<SIRDS::RowScratch> rowScratch;
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "TextureSink.h"
+#include "DebugMe.h"
+
+void TextureSink::Init(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    m_device = device;
+    m_context = context;
+    m_texture.Reset();
+    m_view.Reset();
+    m_textureFormat = DXGI_FORMAT_UNKNOWN;
+}
+
+void TextureSink::SetFormat(DXGI_FORMAT format)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_format = format;
+}
+
+SIRDS::PixelView TextureSink::BeginFrame(int width, int height)
+{
+    DXGI_FORMAT format;
+    {
+        // The buffer is still being read until the last frame went up.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_deferred)
+            m_uploaded.wait(lock, [this] { return !m_ready; });
+        format = m_format;
+    }
+    if (width != m_frame.Width() || height != m_frame.Height() || format != m_frameFormat)
+    {
+        m_frame.Reset();
+        m_frame = SIRDS::FramePool::Shared().Acquire(width, height, format);
+        m_frameFormat = format;
+    }
+    return m_frame.Pixels();
+}
+
+void TextureSink::EndFrame()
+{
+    if (!m_deferred)
+    {
+        UploadFrame();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready = true;
+}
+
+bool TextureSink::Upload()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_ready)
+            return false;
+    }
+    UploadFrame();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready = false;
+    }
+    m_uploaded.notify_all();
+    return true;
+}
+
+// Texture work stays on the context's thread, so a resize never releases a
+// texture the game thread is still drawing with.
+void TextureSink::UploadFrame()
+{
+    const int width = m_frame.Width();
+    const int height = m_frame.Height();
+    if (width != m_textureWidth || height != m_textureHeight || m_frameFormat != m_textureFormat)
+    {
+        m_texture.Reset();
+        m_view.Reset();
+        m_textureWidth = width;
+        m_textureHeight = height;
+        m_textureFormat = m_frameFormat;
+
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = width;
+        desc.Height = height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = m_frameFormat;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, m_texture.GetAddressOf());
+        if (SUCCEEDED(hr))
+            hr = m_device->CreateShaderResourceView(m_texture.Get(), nullptr, m_view.GetAddressOf());
+        if (FAILED(hr))
+        {
+            DebugOut() << "TextureSink texture failed: " << hr;
+            m_texture.Reset();
+            m_view.Reset();
+        }
+    }
+    if (m_texture)
+        m_context->UpdateSubresource(m_texture.Get(), 0, nullptr, m_frame.Data(),
+            static_cast<UINT>(m_frame.RowPitch()), 0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <mutex>
+
+#include "SirdsFramePool.h"
+
+// Frame sink that keeps the stereogram in one pooled buffer and uploads it into
+// a persistent texture. The engine draws straight into the buffer, so the
+// only full-frame copy left is the upload itself; rows the engine skips keep
+// last frame's pixels because the buffer is never handed out fresh.
+//
+// In deferred mode the frame is drawn on another thread (a FramePipeline) and
+// Upload() pushes it to the texture from the thread that owns the device
+// context. The next frame is not started until the last one was uploaded.
+class TextureSink : public SIRDS::FrameSink
+{
+public:
+    void Init(ID3D11Device* device, ID3D11DeviceContext* context);
+
+    // Format of the rows about to be drawn; a change recreates the texture.
+    void SetFormat(DXGI_FORMAT format);
+    void SetDeferred(bool deferred) { m_deferred = deferred; }
+
+    SIRDS::PixelView BeginFrame(int width, int height) override;
+    void EndFrame() override;
+
+    // Deferred mode only: uploads a finished frame, if there is one. Call from
+    // the thread that owns the context. Returns true when a frame went up.
+    bool Upload();
+
+    ID3D11ShaderResourceView* View() const { return m_view.Get(); }
+
+private:
+    void UploadFrame();
+
+    Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_texture;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_view;
+    SIRDS::FrameLease m_frame;
+    DXGI_FORMAT m_format = DXGI_FORMAT_B8G8R8X8_UNORM;
+    DXGI_FORMAT m_frameFormat = DXGI_FORMAT_UNKNOWN;
+    DXGI_FORMAT m_textureFormat = DXGI_FORMAT_UNKNOWN;
+    int m_textureWidth = 0;
+    int m_textureHeight = 0;
+
+    bool m_deferred = false;
+    bool m_ready = false;  // a drawn frame is waiting for Upload()
+    std::mutex m_mutex;
+    std::condition_variable m_uploaded;
+};
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <cstdint>
 #include <cmath>
+#include <limits>
 #include <vector>
 #include "Voronoi.h"
+#include "SirdsSimd.h"
 
 namespace Voronoi
 {
@@ -97,5 +100,171 @@ namespace Voronoi
 		return LerpColor(c0, c1, finalT);
 	}
 
+	// --- Stone tiles ----------------------------------------------------------
+	namespace {
+		// Crack shading, as a fraction of the cell size.
+		constexpr float kCrackReach = 0.8f;   // distance that counts as the far edge
+		constexpr float kCrackWidth = 0.9f;   // how wide cracks appear
+		constexpr float kCrackDepth = 0.8f;   // how dark the middle of a crack gets
+		constexpr float kDarkTone = 0.45f;
+	}
+
+	void StoneGrid::Reset(float cellSize, int seed, uint32_t color1, uint32_t color2, uint32_t color3)
+	{
+		cellSize_ = cellSize;
+		seed_ = seed;
+		colors_[0] = color1;
+		colors_[1] = color2;
+		colors_[2] = color3;
+		width_ = height_ = 0;
+	}
+
+	void StoneGrid::Build(int width, int height)
+	{
+		width_ = height_ = 0;
+		if (width <= 0 || height <= 0)
+			return;
+		width_ = width;
+		height_ = height;
+
+		// Pixel centres fall in cells [0, last]; the neighbourhood reaches one further.
+		const int cols = int(floorf((float(width - 1) + 0.5f) / cellSize_)) + 3;
+		const int rows = int(floorf((float(height - 1) + 0.5f) / cellSize_)) + 3;
+		stride_ = cols;
+		const size_t cells = size_t(cols) * rows;
+		siteX_.resize(cells);
+		siteY_.resize(cells);
+		base_.resize(cells);
+		dark_.resize(cells);
+		for (int r = 0; r < rows; r++) {
+			for (int c = 0; c < cols; c++) {
+				const int sx = c - 1;
+				const int sy = r - 1;
+				const size_t i = size_t(r) * cols + c;
+				const float rx = Hash01(sx, sy, seed_ + 1) - 0.5f;
+				const float ry = Hash01(sx, sy, seed_ + 2) - 0.5f;
+				siteX_[i] = (sx + 0.5f + rx) * cellSize_;
+				siteY_[i] = (sy + 0.5f + ry) * cellSize_;
+				SiteColors(Hash32(sx, sy, seed_), base_[i], dark_[i]);
+			}
+		}
+	}
+
+	// Base colour mixes color1/color2/color3 by the site hash.
+	void StoneGrid::SiteColors(uint32_t siteHash, uint32_t& base, uint32_t& dark) const
+	{
+		const float h = (siteHash & 0xFFFF) / float(0x10000);
+		base = (h < 0.5f) ? LerpColor(colors_[0], colors_[1], h * 2.0f) : LerpColor(colors_[1], colors_[2], (h - 0.5f) * 2.0f);
+		dark = LerpColor(base, 0xFF000000u | (base & 0x00FFFFFFu), kDarkTone);
+	}
+
+	uint32_t StoneGrid::Stone(float dist, uint32_t base, uint32_t dark) const
+	{
+		const float t = std::min(dist / (cellSize_ * kCrackReach), 1.0f);
+		// 0 at the centre of a crack, 1 away from it.
+		const float crackFactor = fabsf(t - 0.5f) * 2.0f;
+		const float crack = 1.0f - std::min(1.0f, crackFactor * (1.0f / kCrackWidth));
+		return LerpColor(base, dark, crack * kCrackDepth);
+	}
+
+	uint32_t StoneGrid::ShadeUncached(int x, int y) const
+	{
+		float dist;
+		uint32_t siteHash;
+		VoronoiNearest(float(x) + 0.5f, float(y) + 0.5f, cellSize_, seed_, dist, siteHash);
+		uint32_t base, dark;
+		SiteColors(siteHash, base, dark);
+		return Stone(dist, base, dark);
+	}
+
+	void StoneGrid::Shade(int y, const uint16_t* xs, int count, uint32_t* row) const
+	{
+		const float* siteX = siteX_.data();
+		const float* siteY = siteY_.data();
+		const float yf = float(y) + 0.5f;
+		// Index of cell (0, gy - 1); neighbours are offsets from here.
+		const int rowBase = int(floorf(yf / cellSize_)) * stride_ + 1;
+		int i = 0;
+
+#if defined(SIRDS_AVX2)
+		{
+			const __m256 cell = _mm256_set1_ps(cellSize_);
+			const __m256 yv = _mm256_set1_ps(yf);
+			const __m256 half = _mm256_set1_ps(0.5f);
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 reach = _mm256_set1_ps(cellSize_ * kCrackReach);
+			const __m256 invWidth = _mm256_set1_ps(1.0f / kCrackWidth);
+			const __m256 depth = _mm256_set1_ps(kCrackDepth);
+			const __m256 two = _mm256_set1_ps(2.0f);
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+			const __m256i byteMask = _mm256_set1_epi32(0xFF);
+			for (; i + 8 <= count; i += 8) {
+				const __m256i xi = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i)));
+				const __m256 xf = _mm256_add_ps(_mm256_cvtepi32_ps(xi), half);
+				const __m256i gx = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(xf, cell)));
+				const __m256i centre = _mm256_add_epi32(gx, _mm256_set1_epi32(rowBase));
+
+				// Same visiting order and strict compare as VoronoiNearest, so ties
+				// go to the same site.
+				__m256 best = _mm256_set1_ps(std::numeric_limits<float>::max());
+				__m256i bestIdx = _mm256_setzero_si256();
+				for (int oy = 0; oy <= 2; ++oy) {
+					for (int ox = -1; ox <= 1; ++ox) {
+						const __m256i idx = _mm256_add_epi32(centre, _mm256_set1_epi32(oy * stride_ + ox));
+						const __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(siteX, idx, 4), xf);
+						const __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(siteY, idx, 4), yv);
+						const __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+						const __m256 closer = _mm256_cmp_ps(d2, best, _CMP_LT_OQ);
+						best = _mm256_blendv_ps(best, d2, closer);
+						bestIdx = _mm256_blendv_epi8(bestIdx, idx, _mm256_castps_si256(closer));
+					}
+				}
+
+				const __m256 t = _mm256_min_ps(_mm256_div_ps(_mm256_sqrt_ps(best), reach), one);
+				const __m256 crackFactor = _mm256_mul_ps(_mm256_and_ps(_mm256_sub_ps(t, half), absMask), two);
+				const __m256 crack = _mm256_sub_ps(one, _mm256_min_ps(one, _mm256_mul_ps(crackFactor, invWidth)));
+				const __m256 s = _mm256_mul_ps(crack, depth);
+
+				// LerpColor on all four channels: a + (b - a) * s, truncated.
+				const __m256i base = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base_.data()), bestIdx, 4);
+				const __m256i dark = _mm256_i32gather_epi32(reinterpret_cast<const int*>(dark_.data()), bestIdx, 4);
+				__m256i colour = _mm256_setzero_si256();
+				for (int shift = 0; shift < 32; shift += 8) {
+					const __m256i a = _mm256_and_si256(_mm256_srli_epi32(base, shift), byteMask);
+					const __m256i b = _mm256_and_si256(_mm256_srli_epi32(dark, shift), byteMask);
+					const __m256 v = _mm256_add_ps(_mm256_cvtepi32_ps(a),
+						_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(b, a)), s));
+					colour = _mm256_or_si256(colour,
+						_mm256_slli_epi32(_mm256_and_si256(_mm256_cvttps_epi32(v), byteMask), shift));
+				}
+
+				alignas(32) uint32_t out[8];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(out), colour);
+				for (int k = 0; k < 8; k++)
+					row[xs[i + k]] = out[k];
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			const int x = xs[i];
+			const float xf = float(x) + 0.5f;
+			const int centre = rowBase + int(floorf(xf / cellSize_));
+			float best = std::numeric_limits<float>::max();
+			int bestIdx = centre;
+			for (int oy = 0; oy <= 2; ++oy) {
+				for (int ox = -1; ox <= 1; ++ox) {
+					const int idx = centre + oy * stride_ + ox;
+					const float dx = siteX[idx] - xf;
+					const float dy = siteY[idx] - yf;
+					const float d2 = dx * dx + dy * dy;
+					if (d2 < best) {
+						best = d2;
+						bestIdx = idx;
+					}
+				}
+			}
+			row[x] = Stone(sqrtf(best), base_[bestIdx], dark_[bestIdx]);
+		}
+	}
 }
 // ---------------------------------------------------------------------------
\ No newline at end of file
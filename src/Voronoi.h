@@ -14,4 +14,43 @@ namespace Voronoi
 	// - `colors` is the palette (32-bit ARGB values).
 	// - `blend` in [0,1] controls how much to mix with a neighbor palette color (0 = no blend).
 	uint32_t VoronoiColor(float x, float y, float cellSize, int seed, const std::vector<uint32_t>& colors, float blend = 0.0f);
+
+	// Stone tiles: Voronoi cells shaded between three colours, darker near
+	// the cracks. The jittered site and the two colours of every cell the
+	// picture touches are worked out once in Build, so a pixel only compares
+	// squared distances to its 3x3 neighbourhood and takes one sqrt for the
+	// winner. Gives the same colours as the per-pixel VoronoiNearest path.
+	class StoneGrid
+	{
+	public:
+		// Sets the look and drops the cached cells.
+		void Reset(float cellSize, int seed, uint32_t color1, uint32_t color2, uint32_t color3);
+		// Caches the cells for a picture of this size.
+		void Build(int width, int height);
+
+		// True when the grid was built for a picture of this size.
+		bool Covers(int width, int height) const { return width == width_ && height == height_ && width > 0; }
+
+		// Sets row[xs[i]] for the count columns in xs, all on row y. Runs
+		// eight pixels per step with AVX2.
+		void Shade(int y, const uint16_t* xs, int count, uint32_t* row) const;
+
+		// One pixel without the grid, for pictures it does not cover.
+		uint32_t ShadeUncached(int x, int y) const;
+
+	private:
+		uint32_t Stone(float dist, uint32_t base, uint32_t dark) const;
+		void SiteColors(uint32_t siteHash, uint32_t& base, uint32_t& dark) const;
+
+		int width_ = 0;
+		int height_ = 0;
+		int stride_ = 0;  // cells per grid row, including one either side of the picture
+		float cellSize_ = 1.f;
+		int seed_ = 0;
+		uint32_t colors_[3] = {};
+		std::vector<float> siteX_;
+		std::vector<float> siteY_;
+		std::vector<uint32_t> base_;
+		std::vector<uint32_t> dark_;
+	};
 }
\ No newline at end of file